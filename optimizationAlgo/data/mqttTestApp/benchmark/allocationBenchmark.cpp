@@ -0,0 +1,180 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include "benchmarkHarness.h"
+#include "../subscribe/discreteEventSim.h"
+using namespace std;
+
+// Usage: allocationBenchmark [--json=path] [--days=N]
+// Counts the heap allocations of a single-region simulation once its pools
+// and buffers have grown, by replacing every form of the global operator new
+// and delete. The first day warms up, the count covers the days after it and
+// should stay near the handful of allocations of each end of day report.
+// Run it from a scratch directory, the region writes its log files
+
+static atomic<unsigned long long> allocations{0};
+
+// Every form of new counts and allocates with malloc or aligned_alloc and
+// every form of delete frees with free, so no pointer crosses families
+static void *countedAllocate(size_t size, size_t alignment)
+{
+    allocations.fetch_add(1, memory_order_relaxed);
+    size = size > 0 ? size : 1;
+    if (alignment <= alignof(std::max_align_t))
+    {
+        return malloc(size);
+    }
+    // aligned_alloc wants the size to be a multiple of the alignment
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+static void *countedAllocateOrThrow(size_t size, size_t alignment)
+{
+    if (void *memory = countedAllocate(size, alignment))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size)
+{
+    return countedAllocateOrThrow(size, 0);
+}
+
+void *operator new[](size_t size)
+{
+    return countedAllocateOrThrow(size, 0);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAllocate(size, 0);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAllocate(size, 0);
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    return countedAllocateOrThrow(size, (size_t)alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+    return countedAllocateOrThrow(size, (size_t)alignment);
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return countedAllocate(size, (size_t)alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return countedAllocate(size, (size_t)alignment);
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t, std::align_val_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    free(memory);
+}
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    int days = 3;
+    for (int i = 1; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (option.rfind("--days=", 0) == 0)
+        {
+            days = std::max(2, stoi(option.substr(7)));
+        }
+        else if (!parseBenchmarkOption(option, options))
+        {
+            cerr << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+    BenchmarkReport report("allocationBenchmark", options);
+
+    auto *coutBuffer = cout.rdbuf();
+    cout.rdbuf(nullptr);
+    DiscreteEventSimulation simulation("Oregon", 3);
+    simulation.runDays(1);
+    unsigned long long before = allocations.load();
+    simulation.runDays(days);
+    unsigned long long counted = allocations.load() - before;
+    cout.rdbuf(coutBuffer);
+
+    BenchmarkResult result;
+    result.name = "steadyStateAllocations";
+    result.iterations = days - 1;
+    result.metrics = {{"allocations", (double)counted},
+                      {"allocations_per_day", (double)counted / (days - 1)}};
+    report.add(result);
+
+    report.writeJson();
+    return 0;
+}
@@ -0,0 +1,221 @@
+#ifndef BENCHMARK_HARNESS
+#define BENCHMARK_HARNESS
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+using namespace std;
+
+// Small timing harness shared by the benchmarks. Every benchmark prints a
+// table and, with --json=path, writes the same figures as JSON so results of
+// different commits can be compared by a script
+
+// One measured figure of a benchmark run
+struct BenchmarkResult
+{
+    string name;
+    // Servers in the fleet the operation ran against, 0 when it does not apply
+    size_t servers = 0;
+    uint64_t iterations = 0;
+    // 0 for scenarios that only report metrics
+    double nsPerOp = 0;
+    // Further figures of the run, such as throughput, percentiles or memory
+    vector<pair<string, double>> metrics;
+};
+
+// Clock of one timed run. The body may pause it around setup work that
+// should not count, such as completing the processes it just placed
+class BenchmarkTimer
+{
+public:
+    BenchmarkTimer()
+    {
+        running = false;
+        elapsed = chrono::steady_clock::duration::zero();
+    }
+
+    void resume()
+    {
+        if (!running)
+        {
+            startedAt = chrono::steady_clock::now();
+            running = true;
+        }
+    }
+
+    void pause()
+    {
+        if (running)
+        {
+            elapsed += chrono::steady_clock::now() - startedAt;
+            running = false;
+        }
+    }
+
+    double seconds()
+    {
+        pause();
+        return chrono::duration<double>(elapsed).count();
+    }
+
+private:
+    bool running;
+    chrono::steady_clock::time_point startedAt;
+    chrono::steady_clock::duration elapsed;
+};
+
+// Options every benchmark understands
+struct BenchmarkOptions
+{
+    // Write the results as JSON to this file as well
+    string jsonPath;
+    // Only run the benchmarks whose name contains this
+    string filter;
+    // Smaller fleets and shorter runs, to check the benchmarks still work
+    bool quick = false;
+    // A timed run is repeated with twice the iterations until it lasts this long
+    double minSeconds = 0.5;
+};
+
+// Parses the shared options, other options are left to the benchmark.
+// Returns false on an option that neither understands
+inline bool parseBenchmarkOption(const string &option, BenchmarkOptions &options)
+{
+    if (option.rfind("--json=", 0) == 0)
+    {
+        options.jsonPath = option.substr(7);
+    }
+    else if (option.rfind("--filter=", 0) == 0)
+    {
+        options.filter = option.substr(9);
+    }
+    else if (option == "--quick")
+    {
+        options.quick = true;
+        options.minSeconds = 0.05;
+    }
+    else if (option.rfind("--min-seconds=", 0) == 0)
+    {
+        options.minSeconds = stod(option.substr(14));
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// Largest resident set of the process so far in kilobytes
+inline long peakResidentKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Collects the results of one benchmark program, prints each as it comes in
+// and writes them all as JSON at the end
+class BenchmarkReport
+{
+public:
+    BenchmarkReport(string programInput, BenchmarkOptions optionsInput)
+    {
+        program = programInput;
+        options = optionsInput;
+    }
+
+    bool selected(const string &name) const
+    {
+        return options.filter.empty() || name.find(options.filter) != string::npos;
+    }
+
+    // Runs body with a growing number of iterations until one run lasts at
+    // least the minimum time, and records the time per iteration of that run
+    void measure(const string &name, size_t servers, const function<void(uint64_t iterations, BenchmarkTimer &timer)> &body)
+    {
+        if (!selected(name))
+        {
+            return;
+        }
+        uint64_t iterations = 1;
+        while (true)
+        {
+            BenchmarkTimer timer;
+            timer.resume();
+            body(iterations, timer);
+            double seconds = timer.seconds();
+            if (seconds >= options.minSeconds || iterations >= (1ULL << 40))
+            {
+                BenchmarkResult result;
+                result.name = name;
+                result.servers = servers;
+                result.iterations = iterations;
+                result.nsPerOp = seconds * 1e9 / iterations;
+                add(result);
+                return;
+            }
+            // Aim a little past the minimum so the next run usually is the last
+            double scale = seconds > 0 ? options.minSeconds * 1.4 / seconds : 10;
+            iterations = std::max(iterations * 2, (uint64_t)(iterations * std::min(scale, 100.0)));
+        }
+    }
+
+    void add(const BenchmarkResult &result)
+    {
+        results.push_back(result);
+        cout << left << setw(28) << result.name << right << setw(9) << result.servers << " servers";
+        if (result.nsPerOp > 0)
+        {
+            cout << setw(14) << fixed << setprecision(1) << result.nsPerOp << " ns/op" << setw(12) << result.iterations << " ops";
+        }
+        for (const auto &metric : result.metrics)
+        {
+            cout << "  " << metric.first << "=" << defaultfloat << setprecision(6) << metric.second;
+        }
+        cout << defaultfloat << endl;
+    }
+
+    // Throws std::runtime_error if the JSON file cannot be written
+    void writeJson() const
+    {
+        if (options.jsonPath.empty())
+        {
+            return;
+        }
+        ofstream file(options.jsonPath, std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Cannot write benchmark results to " + options.jsonPath);
+        }
+        file << "{\n  \"program\": \"" << program << "\",\n  \"quick\": " << (options.quick ? "true" : "false")
+             << ",\n  \"results\": [";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const BenchmarkResult &result = results[i];
+            file << (i > 0 ? "," : "") << "\n    {\"name\": \"" << result.name << "\", \"servers\": " << result.servers
+                 << ", \"iterations\": " << result.iterations << ", \"ns_per_op\": " << setprecision(17) << result.nsPerOp;
+            for (const auto &metric : result.metrics)
+            {
+                file << ", \"" << metric.first << "\": " << metric.second;
+            }
+            file << "}";
+        }
+        file << "\n  ]\n}\n";
+    }
+
+private:
+    string program;
+    BenchmarkOptions options;
+    vector<BenchmarkResult> results;
+};
+
+#endif
@@ -0,0 +1,223 @@
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "benchmarkHarness.h"
+#include "../subscribe/messageReceiver.h"
+using namespace std;
+
+// Usage: placementBenchmark [--quick] [--json=path] [--filter=name] [--min-seconds=N]
+// Times the hot operations of a region against fleets of 10, 1k and 100k
+// servers on a virtual clock, so nothing completes unless the benchmark says so.
+// Run it from a scratch directory, each fleet writes the region's log files
+
+// Fleet processes never complete during a benchmark, the ones a benchmark
+// places itself complete after a millisecond of virtual time
+static constexpr uint32_t fleetDurationMs = 1000000000;
+static constexpr uint32_t benchmarkDurationMs = 1;
+
+// Swallows the report output while it is timed
+class NullBuffer : public streambuf
+{
+protected:
+    int overflow(int c) override
+    {
+        return c;
+    }
+};
+
+// A region grown to the given number of servers by placing long running requests
+struct BenchmarkFleet
+{
+    BenchmarkFleet(size_t servers)
+    {
+        clock = make_shared<VirtualClock>();
+        region = make_unique<RegionalAlgo>("Oregon", RegionConfig(), clock);
+        while ((size_t)region->getServerCount() < servers)
+        {
+            region->addProcessToServer(makeRequestMessage(nextRequestId++, fleetDurationMs, 1400, 2500));
+        }
+    }
+
+    // Complete the processes the benchmark placed so the fleet is back to its size
+    void completeBenchmarkProcesses()
+    {
+        clock->advanceTo(clock->now() + chrono::milliseconds(benchmarkDurationMs));
+        region->dispatchDueEvents();
+    }
+
+    shared_ptr<VirtualClock> clock;
+    unique_ptr<RegionalAlgo> region;
+    uint64_t nextRequestId = 0;
+};
+
+static void benchmarkFleet(BenchmarkReport &report, size_t fleetSize)
+{
+    BenchmarkFleet fleet(fleetSize);
+    RegionalAlgo &region = *fleet.region;
+    size_t servers = region.getServerCount();
+    NullBuffer nullBuffer;
+
+    // Placements in rounds small enough that the fleet does not outgrow its
+    // size, each round is completed with the clock paused
+    report.measure("addProcessToServer", servers, [&](uint64_t iterations, BenchmarkTimer &timer)
+                   {
+                       uint64_t round = std::max<uint64_t>(1, std::min<uint64_t>(1000, servers / 10));
+                       for (uint64_t done = 0; done < iterations; done += round)
+                       {
+                           uint64_t count = std::min(round, iterations - done);
+                           for (uint64_t i = 0; i < count; ++i)
+                           {
+                               region.addProcessToServer(makeRequestMessage(fleet.nextRequestId++, benchmarkDurationMs, 1400, 2500));
+                           }
+                           timer.pause();
+                           fleet.completeBenchmarkProcesses();
+                           timer.resume();
+                       } });
+
+    // Move servers between the status 2 and 3 buckets, where a filled fleet
+    // keeps its servers. Neither move scales up, and every server is put back
+    // where it was afterwards
+    vector<Server *> movable;
+    for (Server *server : region.getServers())
+    {
+        if (server->serverStatus == 2 || server->serverStatus == 3)
+        {
+            movable.push_back(server);
+        }
+    }
+    if (!movable.empty())
+    {
+        vector<int> originalStatus;
+        for (Server *server : movable)
+        {
+            originalStatus.push_back(server->serverStatus);
+        }
+        report.measure("changeServerType", servers, [&](uint64_t iterations, BenchmarkTimer &)
+                       {
+                           for (uint64_t i = 0; i < iterations; ++i)
+                           {
+                               Server *server = movable[i % movable.size()];
+                               int status = server->serverStatus == 2 ? 3 : 2;
+                               region.changeServerType(server, status);
+                               server->serverStatus = status;
+                           } });
+        for (size_t i = 0; i < movable.size(); ++i)
+        {
+            if (movable[i]->serverStatus != originalStatus[i])
+            {
+                region.changeServerType(movable[i], originalStatus[i]);
+                movable[i]->serverStatus = originalStatus[i];
+            }
+        }
+    }
+
+    // The status check of servers whose process count did not change, the
+    // common case after a placement
+    vector<Server *> running;
+    for (Server *server : region.getServers())
+    {
+        if (server->getTotalProcessNum() > 0)
+        {
+            running.push_back(server);
+        }
+    }
+    report.measure("Server::changeStatus", servers, [&](uint64_t iterations, BenchmarkTimer &)
+                   {
+                       for (uint64_t i = 0; i < iterations; ++i)
+                       {
+                           running[i % running.size()]->changeStatus();
+                       } });
+
+    auto *coutBuffer = cout.rdbuf();
+    report.measure("regionalReport", servers, [&](uint64_t iterations, BenchmarkTimer &)
+                   {
+                       cout.rdbuf(&nullBuffer);
+                       for (uint64_t i = 0; i < iterations; ++i)
+                       {
+                           region.regionalReport();
+                       }
+                       cout.rdbuf(coutBuffer); });
+
+    report.measure("readFleetView", servers, [&](uint64_t iterations, BenchmarkTimer &)
+                   {
+                       for (uint64_t i = 0; i < iterations; ++i)
+                       {
+                           region.readFleetView(false);
+                       } });
+
+    report.measure("billRunningServers", servers, [&](uint64_t iterations, BenchmarkTimer &)
+                   {
+                       for (uint64_t i = 0; i < iterations; ++i)
+                       {
+                           region.billRunningServers();
+                       } });
+
+    report.measure("calculateCostBenefitRatio", servers, [&](uint64_t iterations, BenchmarkTimer &)
+                   {
+                       cout.rdbuf(&nullBuffer);
+                       for (uint64_t i = 0; i < iterations; ++i)
+                       {
+                           region.calculateCostBenefitRatio();
+                       }
+                       cout.rdbuf(coutBuffer); });
+}
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (!parseBenchmarkOption(option, options))
+        {
+            cerr << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+    BenchmarkReport report("placementBenchmark", options);
+
+    // The cost of a single server does not depend on the fleet
+    {
+        BenchmarkFleet fleet(1);
+        ShardTotals totals;
+        report.measure("calculateServerCost", 0, [&](uint64_t iterations, BenchmarkTimer &)
+                       {
+                           for (uint64_t i = 0; i < iterations; ++i)
+                           {
+                               fleet.region->calculateServerCost(totals, 60 + (i & 63), Constants::InstanceType::c16);
+                           } });
+    }
+
+    // What a placement pays for its metrics: the block lookup of the calling
+    // thread and one counter, the common case, and a histogram sample
+    {
+        RegionMetrics metrics;
+        report.measure("metrics/add", 0, [&](uint64_t iterations, BenchmarkTimer &)
+                       {
+                           for (uint64_t i = 0; i < iterations; ++i)
+                           {
+                               metrics.local().add(MetricCounter::RequestsPlaced);
+                           } });
+        report.measure("metrics/record", 0, [&](uint64_t iterations, BenchmarkTimer &)
+                       {
+                           for (uint64_t i = 0; i < iterations; ++i)
+                           {
+                               metrics.local().record(MetricHistogram::PlacementNs, 200 + (i & 1023));
+                           } });
+    }
+
+    vector<size_t> fleetSizes = {10, 1000, 100000};
+    if (options.quick)
+    {
+        fleetSizes = {10, 1000};
+    }
+    for (size_t fleetSize : fleetSizes)
+    {
+        benchmarkFleet(report, fleetSize);
+    }
+
+    report.writeJson();
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "benchmarkHarness.h"
+#include "../common/inProcessTransport.h"
+#include "../subscribe/discreteEventSim.h"
+#include "../subscribe/messageReceiver.h"
+using namespace std;
+
+// Usage: scenarioBenchmark [--quick] [--json=path] [--filter=name] [--requests=N] [--days=N] [--repeats=N]
+// End-to-end figures of the whole pipeline: how many arrivals per second a
+// region sustains through the in-process transport and its placement pool,
+// how long requests wait for placement, how much memory it takes, and how
+// fast the discrete-event simulation runs whole days. Every scenario also
+// runs without metrics collection, alternating with the run that collects
+// them, and the fastest of the repeats of each is kept to report what the
+// metrics cost.
+// Run it from a scratch directory, every region writes its log files
+
+// Publishes the requests as fast as the region takes them, then quits the
+// region and reports the throughput from the first request to the last placement
+static BenchmarkResult benchmarkPipeline(uint64_t requests, int shards, bool collectMetrics)
+{
+    RegionConfig config;
+    config.collectMetrics = collectMetrics;
+    config.shardCount = shards;
+    config.placementThreads = std::max(config.placementThreads, shards);
+    InProcessTransport transport;
+    RegionalAlgo region("Oregon", config);
+    auto publisher = transport.createPublisher("benchmark", "Oregon");
+
+    // Short processes so the fleet keeps turning over during the run
+    mt19937 gen(1);
+    uniform_int_distribution<uint32_t> durationDis(20, 60);
+    vector<RequestMessage> batch(InProcessTransport::maxPayloadSize / sizeof(RequestMessage));
+
+    auto start = chrono::steady_clock::now();
+    thread receiver([&]()
+                    { region.messageReceiver(transport); });
+    for (uint64_t sent = 0; sent < requests; sent += batch.size())
+    {
+        size_t count = std::min<uint64_t>(batch.size(), requests - sent);
+        for (size_t i = 0; i < count; ++i)
+        {
+            batch[i] = makeRequestMessage(sent + i, durationDis(gen), 1400, 2500);
+        }
+        publisher->publish(batch.data(), count * sizeof(RequestMessage));
+    }
+    // The receiver waits for the placement pool before it returns
+    publisher->publish("quit");
+    receiver.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    PlacementPoolStats stats = region.getPlacementStats();
+    BenchmarkResult result;
+    result.servers = region.getServerCount();
+    result.iterations = stats.placed;
+    result.nsPerOp = seconds * 1e9 / std::max<uint64_t>(1, stats.placed);
+    result.metrics = {{"arrivals_per_sec", stats.placed / seconds},
+                      {"placement_p50_ms", stats.p50WaitMs},
+                      {"placement_p99_ms", stats.p99WaitMs},
+                      {"placement_max_ms", stats.maxWaitMs},
+                      {"peak_rss_kb", (double)peakResidentKb()}};
+    return result;
+}
+
+// Whole simulated days of the default traffic on a virtual clock
+static BenchmarkResult benchmarkSimulation(int days, bool collectMetrics)
+{
+    RegionConfig config;
+    config.collectMetrics = collectMetrics;
+    auto *coutBuffer = cout.rdbuf();
+    cout.rdbuf(nullptr);
+    auto start = chrono::steady_clock::now();
+    {
+        DiscreteEventSimulation simulation("Oregon", 1, config);
+        simulation.runDays(days);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout.rdbuf(coutBuffer);
+
+    BenchmarkResult result;
+    result.iterations = days;
+    result.nsPerOp = seconds * 1e9 / days;
+    result.metrics = {{"days_per_sec", days / seconds},
+                      {"peak_rss_kb", (double)peakResidentKb()}};
+    return result;
+}
+
+// Runs the scenario with and without metrics collection in turns, reports
+// the fastest run of each and adds the extra time the metrics took, in
+// percent, to the overhead result
+static void compareMetrics(BenchmarkReport &report, BenchmarkResult &overhead, const string &name, int repeats, function<BenchmarkResult(bool collectMetrics)> run)
+{
+    if (!report.selected(name))
+    {
+        return;
+    }
+    BenchmarkResult fastest[2];
+    for (int repeat = 0; repeat < repeats; ++repeat)
+    {
+        for (bool collectMetrics : {false, true})
+        {
+            BenchmarkResult result = run(collectMetrics);
+            BenchmarkResult &best = fastest[collectMetrics];
+            if (repeat == 0 || result.nsPerOp < best.nsPerOp)
+            {
+                best = result;
+            }
+        }
+    }
+    fastest[0].name = name + "/metrics:off";
+    fastest[1].name = name;
+    report.add(fastest[0]);
+    report.add(fastest[1]);
+    string key = name + "_pct";
+    std::replace_if(key.begin(), key.end(), [](char c)
+                    { return !isalnum((unsigned char)c); }, '_');
+    overhead.metrics.push_back({key, (fastest[1].nsPerOp / fastest[0].nsPerOp - 1) * 100});
+}
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    uint64_t requests = 0;
+    int days = 0;
+    int repeats = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (option.rfind("--requests=", 0) == 0)
+        {
+            requests = stoull(option.substr(11));
+        }
+        else if (option.rfind("--days=", 0) == 0)
+        {
+            days = std::max(1, stoi(option.substr(7)));
+        }
+        else if (option.rfind("--repeats=", 0) == 0)
+        {
+            repeats = std::max(1, stoi(option.substr(10)));
+        }
+        else if (!parseBenchmarkOption(option, options))
+        {
+            cerr << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+    if (requests == 0)
+    {
+        requests = options.quick ? 20000 : 1000000;
+    }
+    if (days == 0)
+    {
+        days = options.quick ? 1 : 20;
+    }
+    if (repeats == 0)
+    {
+        repeats = options.quick ? 1 : 3;
+    }
+    BenchmarkReport report("scenarioBenchmark", options);
+
+    BenchmarkResult overhead;
+    overhead.name = "metricsOverhead";
+    for (int shards : {1, 4})
+    {
+        compareMetrics(report, overhead, "pipeline/shards:" + to_string(shards), repeats, [&](bool collectMetrics)
+                       { return benchmarkPipeline(requests, shards, collectMetrics); });
+    }
+    compareMetrics(report, overhead, "simulateDays", repeats, [&](bool collectMetrics)
+                   { return benchmarkSimulation(days, collectMetrics); });
+    if (!overhead.metrics.empty())
+    {
+        report.add(overhead);
+    }
+
+    report.writeJson();
+    return 0;
+}
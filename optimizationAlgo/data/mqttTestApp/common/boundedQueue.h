@@ -0,0 +1,125 @@
+#ifndef BOUNDED_QUEUE
+#define BOUNDED_QUEUE
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+using namespace std;
+
+// Fixed capacity lock-free queue that any number of threads may push to and
+// pop from. Every slot carries a sequence number that tells producers and
+// consumers whether it is free for the current lap around the ring, so a push
+// or pop is one compare-and-swap on the shared position plus one slot write.
+// The capacity is rounded up to a power of two
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t requestedCapacity)
+    {
+        capacity = 1;
+        while (capacity < requestedCapacity)
+        {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+        slots = make_unique<Slot[]>(capacity);
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            slots[i].sequence.store(i, memory_order_relaxed);
+        }
+        enqueuePosition.store(0, memory_order_relaxed);
+        dequeuePosition.store(0, memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    // Returns false without blocking when the queue is full
+    bool tryPush(const T &value)
+    {
+        size_t position = enqueuePosition.load(memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = slots[position & mask];
+            size_t sequence = slot.sequence.load(memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+            if (difference == 0)
+            {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+                {
+                    slot.value = value;
+                    slot.sequence.store(position + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = enqueuePosition.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // Returns false without blocking when the queue is empty
+    bool tryPop(T &value)
+    {
+        size_t position = dequeuePosition.load(memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = slots[position & mask];
+            size_t sequence = slot.sequence.load(memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+            if (difference == 0)
+            {
+                if (dequeuePosition.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+                {
+                    value = std::move(slot.value);
+                    slot.sequence.store(position + mask + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = dequeuePosition.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate number of queued items, exact when no push or pop is in flight
+    size_t size() const
+    {
+        size_t enqueued = enqueuePosition.load(memory_order_acquire);
+        size_t dequeued = dequeuePosition.load(memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    size_t getCapacity() const
+    {
+        return capacity;
+    }
+
+private:
+    struct Slot
+    {
+        atomic<size_t> sequence;
+        T value;
+    };
+
+    // Producers and consumers touch different positions, keep them on
+    // different cache lines
+    alignas(64) atomic<size_t> enqueuePosition;
+    alignas(64) atomic<size_t> dequeuePosition;
+    alignas(64) unique_ptr<Slot[]> slots;
+    size_t capacity;
+    size_t mask;
+};
+
+#endif
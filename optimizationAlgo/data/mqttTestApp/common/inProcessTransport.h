@@ -0,0 +1,212 @@
+#ifndef IN_PROCESS_TRANSPORT
+#define IN_PROCESS_TRANSPORT
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "boundedQueue.h"
+#include "requestMessage.h"
+#include "transport.h"
+using namespace std;
+
+// Hands messages from publishers to subscribers of the same process through a
+// lock-free queue per topic, so the regional algorithm can be driven without
+// a broker. A topic is a single queue: with several subscribers each message
+// goes to one of them. Publishers block while the queue of their topic is full
+class InProcessTransport : public Transport
+{
+public:
+    // Largest payload a queue slot holds. Request payloads above it are split
+    // into several messages on request boundaries, which the receiver cannot
+    // tell apart from separate messages
+    static constexpr size_t maxPayloadSize = 8 * sizeof(RequestMessage);
+
+    explicit InProcessTransport(size_t queueDepthInput = 4096)
+    {
+        queueDepth = queueDepthInput;
+    }
+
+    unique_ptr<Publisher> createPublisher(const string &, const string &topic) override
+    {
+        return make_unique<InProcessPublisher>(channelOf(topic));
+    }
+
+    unique_ptr<Subscriber> createSubscriber(const string &, const string &topic) override
+    {
+        return make_unique<InProcessSubscriber>(channelOf(topic));
+    }
+
+private:
+    struct QueuedMessage
+    {
+        size_t size;
+        char data[maxPayloadSize];
+    };
+
+    struct Channel
+    {
+        explicit Channel(size_t queueDepth)
+            : queue(queueDepth)
+        {
+            sleepingSubscribers = 0;
+            waitingPublishers = 0;
+        }
+
+        // Only take the mutex when a subscriber is actually asleep. The fence
+        // pairs with the one in receive() so that either the subscriber sees
+        // the new message or the publisher sees the sleeping subscriber
+        void wakeSubscriber()
+        {
+            atomic_thread_fence(memory_order_seq_cst);
+            if (sleepingSubscribers.load(memory_order_relaxed) > 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(wakeMutex);
+                }
+                wakeCondition.notify_one();
+            }
+        }
+
+        // Same handshake for publishers waiting on a full queue, the
+        // subscriber wakes them once it took a message
+        void wakePublishers()
+        {
+            atomic_thread_fence(memory_order_seq_cst);
+            if (waitingPublishers.load(memory_order_relaxed) > 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(wakeMutex);
+                }
+                spaceCondition.notify_all();
+            }
+        }
+
+        BoundedQueue<QueuedMessage> queue;
+        atomic<int> sleepingSubscribers;
+        atomic<int> waitingPublishers;
+        std::mutex wakeMutex;
+        std::condition_variable wakeCondition;
+        std::condition_variable spaceCondition;
+    };
+
+    class InProcessPublisher : public Publisher
+    {
+    public:
+        explicit InProcessPublisher(Channel *channelInput)
+        {
+            channel = channelInput;
+        }
+
+        void publish(const void *payload, size_t size) override
+        {
+            const char *bytes = static_cast<const char *>(payload);
+            if (size <= maxPayloadSize)
+            {
+                push(bytes, size);
+                return;
+            }
+            if (!isRequestPayload(payload, size))
+            {
+                throw std::invalid_argument("Payload too large for the in-process transport");
+            }
+            for (size_t offset = 0; offset < size; offset += maxPayloadSize)
+            {
+                push(bytes + offset, std::min(maxPayloadSize, size - offset));
+            }
+        }
+
+    private:
+        void push(const char *bytes, size_t size)
+        {
+            message.size = size;
+            memcpy(message.data, bytes, size);
+            // A full queue means the subscriber is behind, wait for it instead
+            // of dropping the message
+            while (!channel->queue.tryPush(message))
+            {
+                channel->wakeSubscriber();
+                std::unique_lock<std::mutex> lock(channel->wakeMutex);
+                channel->waitingPublishers.fetch_add(1, memory_order_relaxed);
+                atomic_thread_fence(memory_order_seq_cst);
+                if (channel->queue.size() >= channel->queue.getCapacity())
+                {
+                    channel->spaceCondition.wait(lock);
+                }
+                channel->waitingPublishers.fetch_sub(1, memory_order_relaxed);
+            }
+            channel->wakeSubscriber();
+        }
+
+        Channel *channel;
+        QueuedMessage message;
+    };
+
+    class InProcessSubscriber : public Subscriber
+    {
+    public:
+        explicit InProcessSubscriber(Channel *channelInput)
+        {
+            channel = channelInput;
+        }
+
+        bool receive(ReceivedMessage &message, std::chrono::milliseconds timeout) override
+        {
+            if (tryReceive(message))
+            {
+                return true;
+            }
+            {
+                std::unique_lock<std::mutex> lock(channel->wakeMutex);
+                channel->sleepingSubscribers.fetch_add(1, memory_order_relaxed);
+                atomic_thread_fence(memory_order_seq_cst);
+                if (channel->queue.size() == 0)
+                {
+                    channel->wakeCondition.wait_for(lock, timeout);
+                }
+                channel->sleepingSubscribers.fetch_sub(1, memory_order_relaxed);
+            }
+            return tryReceive(message);
+        }
+
+        bool tryReceive(ReceivedMessage &message) override
+        {
+            if (!channel->queue.tryPop(current))
+            {
+                return false;
+            }
+            channel->wakePublishers();
+            message.data = current.data;
+            message.size = current.size;
+            return true;
+        }
+
+    private:
+        Channel *channel;
+        // Holds the payload handed out by the last receive
+        QueuedMessage current;
+    };
+
+    Channel *channelOf(const string &topic)
+    {
+        std::lock_guard<std::mutex> lock(channelsMutex);
+        auto &channel = channels[topic];
+        if (!channel)
+        {
+            channel = make_unique<Channel>(queueDepth);
+        }
+        return channel.get();
+    }
+
+    size_t queueDepth;
+    std::mutex channelsMutex;
+    map<string, unique_ptr<Channel>> channels;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef LATENCY_HISTOGRAM
+#define LATENCY_HISTOGRAM
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+using namespace std;
+
+// Bucket layout of the histograms. The buckets are exact below 16 and then
+// four per power of two, so a percentile is off by at most a quarter of its value
+struct HistogramBuckets
+{
+    static constexpr int exactBuckets = 16;
+    static constexpr int count = exactBuckets + 4 * 60;
+
+    static int bucketOf(uint64_t value)
+    {
+        if (value < exactBuckets)
+        {
+            return (int)value;
+        }
+        int exponent = 63 - __builtin_clzll(value);
+        int quarter = (int)(value >> (exponent - 2)) & 3;
+        return exactBuckets + (exponent - 4) * 4 + quarter;
+    }
+
+    static uint64_t upperBound(int bucket)
+    {
+        if (bucket < exactBuckets)
+        {
+            return bucket;
+        }
+        int exponent = 4 + (bucket - exactBuckets) / 4;
+        uint64_t quarter = (bucket - exactBuckets) % 4;
+        return ((4 + quarter + 1) << (exponent - 2)) - 1;
+    }
+};
+
+// Plain copy of a histogram, histograms recorded on different threads are
+// merged into one before reading percentiles
+struct HistogramSnapshot
+{
+    uint64_t buckets[HistogramBuckets::count] = {};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    void merge(const HistogramSnapshot &other)
+    {
+        for (int i = 0; i < HistogramBuckets::count; ++i)
+        {
+            buckets[i] += other.buckets[i];
+        }
+        count += other.count;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    double mean() const
+    {
+        return count > 0 ? (double)sum / count : 0;
+    }
+
+    // Upper end of the bucket holding the given quantile of the samples
+    uint64_t percentile(double quantile) const
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(quantile * count));
+        uint64_t seen = 0;
+        for (int i = 0; i < HistogramBuckets::count; ++i)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+            {
+                return std::min(HistogramBuckets::upperBound(i), max);
+            }
+        }
+        return max;
+    }
+};
+
+// Distribution of latencies in any integer unit, recorded from any number of
+// threads without locking
+class LatencyHistogram
+{
+public:
+    void record(uint64_t value)
+    {
+        buckets[HistogramBuckets::bucketOf(value)].fetch_add(1, memory_order_relaxed);
+        count.fetch_add(1, memory_order_relaxed);
+        sum.fetch_add(value, memory_order_relaxed);
+        uint64_t largest = maximum.load(memory_order_relaxed);
+        while (value > largest && !maximum.compare_exchange_weak(largest, value, memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t samples() const { return count.load(memory_order_relaxed); }
+    uint64_t total() const { return sum.load(memory_order_relaxed); }
+    uint64_t max() const { return maximum.load(memory_order_relaxed); }
+
+    double mean() const
+    {
+        uint64_t recorded = samples();
+        return recorded > 0 ? (double)total() / recorded : 0;
+    }
+
+    uint64_t percentile(double quantile) const
+    {
+        return snapshot().percentile(quantile);
+    }
+
+    // Copy taken while other threads keep recording. The count is taken from
+    // the buckets so percentiles of the copy stay consistent
+    HistogramSnapshot snapshot() const
+    {
+        HistogramSnapshot copy;
+        for (int i = 0; i < HistogramBuckets::count; ++i)
+        {
+            copy.buckets[i] = buckets[i].load(memory_order_relaxed);
+            copy.count += copy.buckets[i];
+        }
+        copy.sum = total();
+        copy.max = max();
+        return copy;
+    }
+
+private:
+    atomic<uint64_t> buckets[HistogramBuckets::count] = {};
+    atomic<uint64_t> count{0};
+    atomic<uint64_t> sum{0};
+    atomic<uint64_t> maximum{0};
+};
+
+#endif
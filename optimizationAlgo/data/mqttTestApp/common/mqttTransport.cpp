@@ -0,0 +1,99 @@
+// Start by `#include`-ing the Mosquitto MQTT Library and other standard libraries.
+#include <mqtt/client.h> // Mosquitto client.
+#include "mqttTransport.h"
+using namespace std;
+
+// Publishes every payload with the one message of its topic
+class MqttPublisher : public Publisher
+{
+public:
+    MqttPublisher(unique_ptr<mqtt::client> clientInput, const string &topic)
+    {
+        client = std::move(clientInput);
+        // Initialize an empty message with specified topic.
+        message = mqtt::make_message(topic, "");
+    }
+
+    void publish(const void *payload, size_t size) override
+    {
+        // Configure Mqtt message to contain the raw bytes of the payload.
+        message->set_payload(payload, size);
+
+        // Publish the Mqtt message using the connected client.
+        client->publish(message);
+    }
+
+private:
+    unique_ptr<mqtt::client> client;
+    mqtt::message_ptr message;
+};
+
+// Hands out the payload of the consumed message in place, without copying it
+class MqttSubscriber : public Subscriber
+{
+public:
+    explicit MqttSubscriber(unique_ptr<mqtt::client> clientInput)
+    {
+        client = std::move(clientInput);
+    }
+
+    bool receive(ReceivedMessage &message, chrono::milliseconds timeout) override
+    {
+        if (!client->try_consume_message_for(&current, timeout))
+        {
+            return false;
+        }
+        fill(message);
+        return true;
+    }
+
+    bool tryReceive(ReceivedMessage &message) override
+    {
+        if (!client->try_consume_message(&current))
+        {
+            return false;
+        }
+        fill(message);
+        return true;
+    }
+
+private:
+    void fill(ReceivedMessage &message)
+    {
+        auto payload = current->get_payload_ref();
+        message.data = payload.data();
+        message.size = payload.size();
+    }
+
+    unique_ptr<mqtt::client> client;
+    // Keeps the payload handed out by the last receive alive
+    mqtt::const_message_ptr current;
+};
+
+//////////////////
+// Mqtt transport class implementation
+MqttTransport::MqttTransport(string brokerAddressInput)
+{
+    brokerAddress = brokerAddressInput;
+}
+
+unique_ptr<Publisher> MqttTransport::createPublisher(const string &clientId, const string &topic)
+{
+    // Construct a client using the broker address and Id, specifying usage of MQTT V5.
+    auto client = make_unique<mqtt::client>(brokerAddress, clientId, mqtt::create_options(MQTTVERSION_5));
+    client->connect();
+    return make_unique<MqttPublisher>(std::move(client), topic);
+}
+
+unique_ptr<Subscriber> MqttTransport::createSubscriber(const string &clientId, const string &topic)
+{
+    // Construct a client using the broker address and Id, specifying usage of MQTT V5.
+    auto client = make_unique<mqtt::client>(brokerAddress, clientId, mqtt::create_options(MQTTVERSION_5));
+    // Use the connect method of the client to establish a connection to the broker.
+    client->connect();
+    // In order to receive messages from the broker, specify a topic to subscribe to.
+    client->subscribe(topic);
+    // Begin the client's message processing loop, filling a queue with messages.
+    client->start_consuming();
+    return make_unique<MqttSubscriber>(std::move(client));
+}
@@ -0,0 +1,22 @@
+#ifndef MQTT_TRANSPORT
+#define MQTT_TRANSPORT
+#include <memory>        // For std::unique_ptr
+#include <string>        // For std::string
+#include "transport.h"
+using namespace std;
+
+// Publishes and subscribes through an MQTT broker, every publisher and
+// subscriber is a client of its own
+class MqttTransport : public Transport
+{
+public:
+    // The broker runs on the localhost on port 1883 unless told otherwise
+    explicit MqttTransport(string brokerAddressInput = "localhost:1883");
+    unique_ptr<Publisher> createPublisher(const string &clientId, const string &topic) override;
+    unique_ptr<Subscriber> createSubscriber(const string &clientId, const string &topic) override;
+
+private:
+    string brokerAddress;
+};
+
+#endif
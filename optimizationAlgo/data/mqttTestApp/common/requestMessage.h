@@ -0,0 +1,96 @@
+#ifndef REQUEST_MESSAGE
+#define REQUEST_MESSAGE
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+using namespace std;
+
+// Fixed-layout request as sent from the request generator to the regional
+// algorithm. The payload is the raw bytes of the struct, so the receiver can
+// read it straight out of the MQTT buffer. Publisher and subscriber run on
+// the same kind of host, the fields are in host byte order
+struct RequestMessage
+{
+    uint32_t magic;
+    uint16_t version;
+    // The low two bits hold the RequestPriority
+    uint16_t flags;
+    uint64_t requestId;
+    // Expected execution time of the process, 200x compressed like every simulated duration
+    uint32_t durationMs;
+    // Resource demand of the process in thousandths of a vCPU and in MB
+    uint32_t vCpuMilli;
+    uint32_t memoryMb;
+    // How long the request may wait for a server when the region is at its
+    // fleet limits, 0 for as long as it takes
+    uint32_t maxWaitMs;
+};
+static_assert(sizeof(RequestMessage) == 32, "RequestMessage is sent over the wire as is");
+
+inline constexpr uint32_t requestMessageMagic = 0x51525347; // "GSRQ"
+inline constexpr uint16_t requestMessageVersion = 1;
+
+// Priority class of a request. Standard is 0, so a publisher that sets no
+// class sends standard requests
+enum class RequestPriority : uint8_t
+{
+    Standard = 0,
+    High = 1,
+    Low = 2,
+};
+
+inline constexpr int requestPriorityCount = 3;
+inline constexpr uint16_t requestPriorityMask = 0x3;
+inline constexpr const char *requestPriorityNames[requestPriorityCount] = {"standard", "high", "low"};
+
+inline RequestPriority requestPriority(const RequestMessage &request)
+{
+    int priority = request.flags & requestPriorityMask;
+    return priority < requestPriorityCount ? static_cast<RequestPriority>(priority) : RequestPriority::Standard;
+}
+
+inline void setRequestPriority(RequestMessage &request, RequestPriority priority)
+{
+    request.flags = (request.flags & ~requestPriorityMask) | static_cast<uint16_t>(priority);
+}
+
+// Fill in the header fields of a request
+inline RequestMessage makeRequestMessage(uint64_t requestId, uint32_t durationMs, uint32_t vCpuMilli, uint32_t memoryMb)
+{
+    RequestMessage request{};
+    request.magic = requestMessageMagic;
+    request.version = requestMessageVersion;
+    request.requestId = requestId;
+    request.durationMs = durationMs;
+    request.vCpuMilli = vCpuMilli;
+    request.memoryMb = memoryMb;
+    return request;
+}
+
+// Returns true when the payload holds one or more whole requests. Text
+// control messages such as "END OF DAY" never pass this check
+inline bool isRequestPayload(const void *payload, size_t size)
+{
+    if (size == 0 || size % sizeof(RequestMessage) != 0)
+    {
+        return false;
+    }
+    uint32_t magic;
+    memcpy(&magic, payload, sizeof(magic));
+    return magic == requestMessageMagic;
+}
+
+// Read the request at the given index of a request payload. memcpy keeps the
+// read valid for unaligned broker buffers and compiles to plain loads
+inline bool decodeRequestMessage(const void *payload, size_t size, size_t index, RequestMessage &request)
+{
+    size_t offset = index * sizeof(RequestMessage);
+    if (offset + sizeof(RequestMessage) > size)
+    {
+        return false;
+    }
+    memcpy(&request, static_cast<const char *>(payload) + offset, sizeof(RequestMessage));
+    return request.magic == requestMessageMagic && request.version == requestMessageVersion;
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef REQUEST_SOURCE
+#define REQUEST_SOURCE
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "requestMessage.h"
+#include "requestTrace.h"
+#include "trafficProfile.h"
+using namespace std;
+
+// Where the arrivals of a region come from
+struct ArrivalOptions
+{
+    TrafficProfile::Profile profile;
+    // Replay <replayPrefix>_<region>.trace instead of generating arrivals
+    string replayPrefix;
+    // Record every arrival to <recordPrefix>_<region>.trace
+    string recordPrefix;
+};
+
+inline string traceFileName(const string &prefix, const string &regionName)
+{
+    return prefix + "_" + regionName + ".trace";
+}
+
+// Arrivals of one region: generated from the traffic profile with a fixed
+// seed or replayed from a trace, and optionally recorded to a trace. The
+// request generator and the discrete-event simulation both draw from it, so a
+// trace recorded by either one replays the same arrival sequence in both
+class RequestSource
+{
+public:
+    RequestSource(const string &regionName, unsigned int seed, const ArrivalOptions &options)
+        : generator(options.profile, seed)
+    {
+        requestId = 0;
+        if (!options.replayPrefix.empty())
+        {
+            replay = make_unique<TraceReader>(traceFileName(options.replayPrefix, regionName));
+        }
+        if (!options.recordPrefix.empty())
+        {
+            recording = make_unique<TraceWriter>(traceFileName(options.recordPrefix, regionName));
+        }
+    }
+
+    // Fills in the next request and the pause in milliseconds before the one
+    // after it, for the given elapsed time of the day. Returns false once a
+    // replayed trace is exhausted
+    bool next(long elapsedSeconds, RequestMessage &request, int &pauseMs)
+    {
+        if (replay)
+        {
+            if (!replay->next(request, pauseMs))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            pauseMs = generator.nextPause(elapsedSeconds);
+            request = generator.nextRequest(requestId++);
+        }
+        if (recording)
+        {
+            recording->append(request, pauseMs);
+        }
+        return true;
+    }
+
+    // Make the recorded arrivals so far readable, a live recording calls this
+    // after every request so a killed generator leaves a usable trace
+    void flush()
+    {
+        if (recording)
+        {
+            recording->flush();
+        }
+    }
+
+private:
+    TrafficProfile::TrafficGenerator generator;
+    unique_ptr<TraceReader> replay;
+    unique_ptr<TraceWriter> recording;
+    uint64_t requestId;
+};
+
+#endif
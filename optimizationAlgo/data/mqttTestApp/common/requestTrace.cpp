@@ -0,0 +1,108 @@
+#include "requestTrace.h"
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+//////////////////
+// Trace writer class implementation
+TraceWriter::TraceWriter(const string &path)
+{
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Cannot create trace file: " + path);
+    }
+    TraceHeader header{};
+    header.magic = traceMagic;
+    header.version = traceVersion;
+    header.recordSize = sizeof(TraceRecord);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+void TraceWriter::append(const RequestMessage &request, int pauseMs)
+{
+    TraceRecord record{};
+    record.request = request;
+    record.pauseMs = pauseMs;
+    file.write(reinterpret_cast<const char *>(&record), sizeof(record));
+}
+
+void TraceWriter::flush()
+{
+    file.flush();
+}
+
+//////////////////
+// Trace reader class implementation
+TraceReader::TraceReader(const string &path)
+{
+    mapping = nullptr;
+    mappingSize = 0;
+    records = nullptr;
+    recordCount = 0;
+    position = 0;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        throw std::runtime_error("Cannot open trace file: " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) == -1 || (size_t)status.st_size < sizeof(TraceHeader))
+    {
+        close(fd);
+        throw std::runtime_error("Not a trace file: " + path);
+    }
+    mappingSize = status.st_size;
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        throw std::runtime_error("Cannot map trace file: " + path);
+    }
+
+    TraceHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    if (header.magic != traceMagic || header.version != traceVersion || header.recordSize != sizeof(TraceRecord))
+    {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        throw std::runtime_error("Not a trace file: " + path);
+    }
+    // The header keeps the records 8 byte aligned within the page aligned
+    // mapping. A record cut short by a killed recording is left out
+    records = reinterpret_cast<const TraceRecord *>(static_cast<const char *>(mapping) + sizeof(TraceHeader));
+    recordCount = (mappingSize - sizeof(TraceHeader)) / sizeof(TraceRecord);
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+}
+
+TraceReader::~TraceReader()
+{
+    if (mapping != nullptr)
+    {
+        munmap(mapping, mappingSize);
+    }
+}
+
+bool TraceReader::next(RequestMessage &request, int &pauseMs)
+{
+    if (position == recordCount)
+    {
+        return false;
+    }
+    request = records[position].request;
+    pauseMs = records[position].pauseMs;
+    ++position;
+    return true;
+}
+
+size_t TraceReader::size() const
+{
+    return recordCount;
+}
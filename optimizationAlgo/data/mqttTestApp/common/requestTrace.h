@@ -0,0 +1,70 @@
+#ifndef REQUEST_TRACE
+#define REQUEST_TRACE
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "requestMessage.h"
+using namespace std;
+
+// A trace file is a TraceHeader followed by one TraceRecord per request, in
+// arrival order. Like the wire format it is in host byte order
+struct TraceHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint64_t reserved;
+};
+static_assert(sizeof(TraceHeader) == 16, "TraceHeader is written to disk as is");
+
+// One request and the pause in milliseconds before the request after it
+struct TraceRecord
+{
+    RequestMessage request;
+    uint32_t pauseMs;
+    uint32_t reserved;
+};
+static_assert(sizeof(TraceRecord) == 40, "TraceRecord is written to disk as is");
+
+inline constexpr uint32_t traceMagic = 0x52545347; // "GSTR"
+inline constexpr uint16_t traceVersion = 1;
+
+// Appends requests to a trace file. The record count is taken from the file
+// size, so a trace stays readable up to the last flushed record even if the
+// recording process is killed
+class TraceWriter
+{
+public:
+    // Throws std::runtime_error if the file cannot be created
+    explicit TraceWriter(const string &path);
+    void append(const RequestMessage &request, int pauseMs);
+    void flush();
+
+private:
+    std::ofstream file;
+};
+
+// Read-only view of a trace file mapped into memory, the records are read in
+// place without copying the file
+class TraceReader
+{
+public:
+    // Throws std::runtime_error if the file cannot be mapped or is not a trace
+    explicit TraceReader(const string &path);
+    ~TraceReader();
+    TraceReader(const TraceReader &) = delete;
+    TraceReader &operator=(const TraceReader &) = delete;
+    // Returns false once every record has been read
+    bool next(RequestMessage &request, int &pauseMs);
+    size_t size() const;
+
+private:
+    void *mapping;
+    size_t mappingSize;
+    const TraceRecord *records;
+    size_t recordCount;
+    size_t position;
+};
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef TRAFFIC_PROFILE
+#define TRAFFIC_PROFILE
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "requestMessage.h"
+using namespace std;
+
+// Shape of a simulated day, shared by the request generator and the
+// discrete-event simulation so both produce the same arrival pattern.
+// All durations are 200x compressed, 432 seconds is one day in real life
+namespace TrafficProfile {
+
+// Seconds into the day where the traffic phases of the default profile end
+inline constexpr long lowTrafficMorningEnd = 144;
+inline constexpr long highTrafficEnd = 288;
+inline constexpr long dayEnd = 432;
+
+// Returns true once the elapsed time of the day has passed the end of the day
+inline bool isEndOfDay(long elapsedSeconds)
+{
+    return elapsedSeconds > dayEnd;
+}
+
+// How the pauses between requests are drawn
+enum class ArrivalModel
+{
+    // Uniformly between the pause bounds of the phase, the original generator
+    Uniform,
+    // Exponential pauses around the mean pause of the phase
+    Poisson,
+    // Exponential pauses whose rate follows a smooth curve over the day, from
+    // the rate of the quietest phase at midnight to the busiest one at noon
+    Diurnal,
+    // Poisson arrivals where an arrival sometimes brings a burst of requests
+    // right after it
+    Bursty,
+};
+
+inline std::optional<ArrivalModel> parseArrivalModel(const string &name)
+{
+    if (name == "uniform")
+    {
+        return ArrivalModel::Uniform;
+    }
+    if (name == "poisson")
+    {
+        return ArrivalModel::Poisson;
+    }
+    if (name == "diurnal")
+    {
+        return ArrivalModel::Diurnal;
+    }
+    if (name == "bursty")
+    {
+        return ArrivalModel::Bursty;
+    }
+    return std::nullopt;
+}
+
+// Stretch of the day, up to endSeconds into it, whose pauses between
+// requests lie between minPauseMs and maxPauseMs
+struct Phase
+{
+    long endSeconds;
+    int minPauseMs;
+    int maxPauseMs;
+};
+
+// Parses phases written as end:minPause-maxPause separated by commas, for
+// example 144:10000-20000,288:1000-2000,432:10000-20000. The ends must
+// increase, nullopt if the text does not describe such phases
+inline std::optional<vector<Phase>> parsePhases(const string &text)
+{
+    vector<Phase> phases;
+    size_t position = 0;
+    while (position < text.size())
+    {
+        size_t comma = text.find(',', position);
+        string part = text.substr(position, comma == string::npos ? string::npos : comma - position);
+        Phase phase;
+        char colon, dash;
+        int consumed = 0;
+        if (sscanf(part.c_str(), "%ld%c%d%c%d%n", &phase.endSeconds, &colon, &phase.minPauseMs, &dash, &phase.maxPauseMs, &consumed) != 5 ||
+            colon != ':' || dash != '-' || consumed != (int)part.size() ||
+            phase.minPauseMs <= 0 || phase.maxPauseMs < phase.minPauseMs ||
+            (!phases.empty() && phase.endSeconds <= phases.back().endSeconds))
+        {
+            return std::nullopt;
+        }
+        phases.push_back(phase);
+        position = comma == string::npos ? text.size() : comma + 1;
+    }
+    if (phases.empty())
+    {
+        return std::nullopt;
+    }
+    return phases;
+}
+
+// Parses the shares of the priority classes written as class:share separated
+// by commas, for example high:0.1,low:0.3. Standard requests take the rest,
+// nullopt if the text names another class or the shares add up to more than 1
+inline std::optional<pair<double, double>> parsePriorityShares(const string &text)
+{
+    double shares[2] = {0, 0};
+    size_t position = 0;
+    while (position < text.size())
+    {
+        size_t comma = text.find(',', position);
+        string part = text.substr(position, comma == string::npos ? string::npos : comma - position);
+        size_t colon = part.find(':');
+        string name = part.substr(0, colon);
+        int index = name == "high" ? 0 : name == "low" ? 1 : -1;
+        char *end = nullptr;
+        double share = colon == string::npos ? -1 : strtod(part.c_str() + colon + 1, &end);
+        if (index == -1 || share < 0 || end == nullptr || *end != '\0')
+        {
+            return std::nullopt;
+        }
+        shares[index] = share;
+        position = comma == string::npos ? text.size() : comma + 1;
+    }
+    if (shares[0] + shares[1] > 1)
+    {
+        return std::nullopt;
+    }
+    return make_pair(shares[0], shares[1]);
+}
+
+// Everything that shapes the synthetic traffic of a region. The defaults are
+// the original day: a quiet morning, a busy middle and a quiet evening
+struct Profile
+{
+    ArrivalModel model = ArrivalModel::Uniform;
+    vector<Phase> phases = {
+        {lowTrafficMorningEnd, 10000, 20000}, // In real life between 33 minute to 66 minutes a request
+        {highTrafficEnd, 1000, 2000},         // In real life between 3.3 minute to 6.6 minutes a request
+        {dayEnd, 10000, 20000},
+    };
+    // Chance that an arrival starts a burst, and the requests and the pause
+    // between them in a burst (Bursty only)
+    double burstProbability = 0.05;
+    int burstSize = 8;
+    int burstPauseMs = 100;
+    // Durations spread evenly around the 60 second average application
+    // execution time and the demand spreads around the per process vCPU (1.4)
+    // and memory (2.5 GB) coefficients of the server model
+    uint32_t minDurationMs = 30000;
+    uint32_t maxDurationMs = 90000;
+    uint32_t minVcpuMilli = 1000;
+    uint32_t maxVcpuMilli = 1800;
+    uint32_t minMemoryMb = 2048;
+    uint32_t maxMemoryMb = 3072;
+    // Shares of high and low priority requests, the rest are standard. No
+    // class is drawn while both are 0, so the default arrivals stay the same
+    double highPriorityShare = 0;
+    double lowPriorityShare = 0;
+    // How long every request may wait for a server when its region is at its
+    // fleet limits, 0 for as long as it takes
+    uint32_t maxWaitMs = 0;
+};
+
+// Synthetic arrivals of one region. With the same profile and seed it
+// produces the same requests and pauses on every run
+class TrafficGenerator
+{
+public:
+    TrafficGenerator(Profile profileInput, unsigned int seed)
+        : gen(seed)
+    {
+        profile = std::move(profileInput);
+        burstRemaining = 0;
+    }
+
+    // Returns the pause in milliseconds until the next request for the given
+    // elapsed time of the day
+    int nextPause(long elapsedSeconds)
+    {
+        const Phase &phase = phaseAt(elapsedSeconds);
+        switch (profile.model)
+        {
+        case ArrivalModel::Uniform:
+            break;
+        case ArrivalModel::Poisson:
+            return exponentialPause(meanPauseMs(phase));
+        case ArrivalModel::Diurnal:
+            return exponentialPause(diurnalMeanPauseMs(elapsedSeconds));
+        case ArrivalModel::Bursty:
+            if (burstRemaining > 0)
+            {
+                --burstRemaining;
+                return profile.burstPauseMs;
+            }
+            if (bernoulli_distribution(profile.burstProbability)(gen))
+            {
+                burstRemaining = profile.burstSize - 1;
+                return profile.burstPauseMs;
+            }
+            return exponentialPause(meanPauseMs(phase));
+        }
+        uniform_int_distribution<> pauseDis(phase.minPauseMs, phase.maxPauseMs);
+        return pauseDis(gen);
+    }
+
+    // Builds the next request
+    RequestMessage nextRequest(uint64_t requestId)
+    {
+        uniform_int_distribution<uint32_t> durationDis(profile.minDurationMs, profile.maxDurationMs);
+        uniform_int_distribution<uint32_t> vCpuDis(profile.minVcpuMilli, profile.maxVcpuMilli);
+        uniform_int_distribution<uint32_t> memoryDis(profile.minMemoryMb, profile.maxMemoryMb);
+
+        uint32_t durationMs = durationDis(gen);
+        uint32_t vCpuMilli = vCpuDis(gen);
+        uint32_t memoryMb = memoryDis(gen);
+        RequestMessage request = makeRequestMessage(requestId, durationMs, vCpuMilli, memoryMb);
+        if (profile.highPriorityShare > 0 || profile.lowPriorityShare > 0)
+        {
+            double draw = uniform_real_distribution<>(0, 1)(gen);
+            if (draw < profile.highPriorityShare)
+            {
+                setRequestPriority(request, RequestPriority::High);
+            }
+            else if (draw < profile.highPriorityShare + profile.lowPriorityShare)
+            {
+                setRequestPriority(request, RequestPriority::Low);
+            }
+        }
+        request.maxWaitMs = profile.maxWaitMs;
+        return request;
+    }
+
+private:
+    // Phase the elapsed time falls into, the last one past its end
+    const Phase &phaseAt(long elapsedSeconds) const
+    {
+        for (const auto &phase : profile.phases)
+        {
+            if (elapsedSeconds < phase.endSeconds)
+            {
+                return phase;
+            }
+        }
+        return profile.phases.back();
+    }
+
+    static double meanPauseMs(const Phase &phase)
+    {
+        return (phase.minPauseMs + phase.maxPauseMs) / 2.0;
+    }
+
+    double diurnalMeanPauseMs(long elapsedSeconds) const
+    {
+        double slowestRate = 1 / meanPauseMs(profile.phases[0]);
+        double fastestRate = slowestRate;
+        for (const auto &phase : profile.phases)
+        {
+            slowestRate = std::min(slowestRate, 1 / meanPauseMs(phase));
+            fastestRate = std::max(fastestRate, 1 / meanPauseMs(phase));
+        }
+        double dayShare = (1 - std::cos(2 * M_PI * elapsedSeconds / dayEnd)) / 2;
+        return 1 / (slowestRate + (fastestRate - slowestRate) * dayShare);
+    }
+
+    int exponentialPause(double meanMs)
+    {
+        exponential_distribution<double> pauseDis(1 / meanMs);
+        return std::max(1, (int)std::lround(pauseDis(gen)));
+    }
+
+    Profile profile;
+    mt19937 gen;
+    // Requests of the current burst still to come
+    int burstRemaining;
+};
+
+} // namespace TrafficProfile
+
+#endif
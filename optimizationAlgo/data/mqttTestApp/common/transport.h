@@ -0,0 +1,61 @@
+#ifndef TRANSPORT
+#define TRANSPORT
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+using namespace std;
+
+// How the request generator and the regional algorithm exchange messages.
+// Every region has a topic named after it; the generator publishes requests
+// and control messages such as "END OF DAY" to it and the region's receiver
+// subscribes to it. MqttTransport goes through the broker, InProcessTransport
+// hands the messages over in memory when both sides run in one process
+
+// Topic on which a region asks the publisher of its requests to hold them
+// back ("PAUSE") while it cannot take more, and to go on ("RESUME")
+inline string backpressureTopic(const string &regionName)
+{
+    return regionName + "/backpressure";
+}
+
+// A received message. The payload stays valid until the next receive on the
+// same subscriber
+struct ReceivedMessage
+{
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+class Publisher
+{
+public:
+    virtual ~Publisher() = default;
+    virtual void publish(const void *payload, size_t size) = 0;
+    void publish(const string &text)
+    {
+        publish(text.data(), text.size());
+    }
+};
+
+class Subscriber
+{
+public:
+    virtual ~Subscriber() = default;
+    // Waits up to the timeout for the next message, false if none arrived
+    virtual bool receive(ReceivedMessage &message, std::chrono::milliseconds timeout) = 0;
+    // Takes a message that has already arrived without waiting
+    virtual bool tryReceive(ReceivedMessage &message) = 0;
+};
+
+// Creates the publishers and subscribers of the topics. A transport must
+// outlive everything it created
+class Transport
+{
+public:
+    virtual ~Transport() = default;
+    virtual unique_ptr<Publisher> createPublisher(const string &clientId, const string &topic) = 0;
+    virtual unique_ptr<Subscriber> createSubscriber(const string &clientId, const string &topic) = 0;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include "workStealingPool.h"
+using namespace std;
+
+// Pool and deque of the calling thread, nullptr outside any pool
+static thread_local WorkStealingPool *currentPool = nullptr;
+static thread_local int currentDeque = -1;
+
+//////////////////
+// Work stealing pool class implementation
+WorkStealingPool::WorkStealingPool(int threadCountInput)
+{
+    threadCount = std::max(1, threadCountInput);
+    nextDeque = 0;
+    running = true;
+    queued = 0;
+    unfinished = 0;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        deques.push_back(make_unique<WorkerDeque>());
+    }
+    for (int i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back(&WorkStealingPool::run, this, i);
+    }
+}
+
+// Waits for the queued tasks before the threads exit
+WorkStealingPool::~WorkStealingPool()
+{
+    waitIdle();
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running = false;
+    }
+    wakeCondition.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(function<void()> task)
+{
+    int index = currentPool == this ? currentDeque : (int)(nextDeque++ % threadCount);
+    ++unfinished;
+    // Counted before it is queued so the count never drops below zero. Taking
+    // the mutex orders the count with a worker about to sleep, so the wake up
+    // cannot fall between its check and its wait
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        ++queued;
+    }
+    {
+        std::lock_guard<std::mutex> lock(deques[index]->mutex);
+        deques[index]->tasks.push_back(std::move(task));
+    }
+    wakeCondition.notify_one();
+}
+
+void WorkStealingPool::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(idleMutex);
+    idleCondition.wait(lock, [this]()
+                       { return unfinished.load() == 0; });
+}
+
+int WorkStealingPool::getThreadCount()
+{
+    return threadCount;
+}
+
+// The newest task of the thread's own deque, or else the oldest task of the
+// first other deque that has one, starting with the next thread's
+bool WorkStealingPool::takeTask(int index, function<void()> &task)
+{
+    {
+        WorkerDeque &own = *deques[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (int offset = 1; offset < threadCount; ++offset)
+    {
+        WorkerDeque &victim = *deques[(index + offset) % threadCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(int index)
+{
+    currentPool = this;
+    currentDeque = index;
+    function<void()> task;
+    while (true)
+    {
+        if (takeTask(index, task))
+        {
+            --queued;
+            task();
+            task = nullptr;
+            if (--unfinished == 0)
+            {
+                std::lock_guard<std::mutex> lock(idleMutex);
+                idleCondition.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeCondition.wait(lock, [this]()
+                           { return queued.load() > 0 || !running.load(); });
+        if (!running.load() && queued.load() == 0)
+        {
+            break;
+        }
+    }
+}
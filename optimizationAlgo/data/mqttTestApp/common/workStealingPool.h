@@ -0,0 +1,57 @@
+#ifndef WORK_STEALING_POOL
+#define WORK_STEALING_POOL
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Runs tasks on a fixed set of threads, each with a deque of its own. A
+// thread runs its newest task first and, once its deque is empty, steals the
+// oldest task of another thread, so tasks of very different lengths keep
+// every thread busy without all of them contending on one queue.
+// Tasks must not throw
+class WorkStealingPool
+{
+public:
+    WorkStealingPool(int threadCountInput);
+    ~WorkStealingPool();
+    // A pool thread queues the task on its own deque, other threads spread
+    // their tasks over the deques in turn
+    void submit(function<void()> task);
+    // Blocks until every submitted task has run
+    void waitIdle();
+    int getThreadCount();
+
+private:
+    struct alignas(64) WorkerDeque
+    {
+        std::mutex mutex;
+        deque<function<void()>> tasks;
+    };
+
+    void run(int index);
+    bool takeTask(int index, function<void()> &task);
+
+    int threadCount;
+    vector<unique_ptr<WorkerDeque>> deques;
+    vector<thread> workers;
+    atomic<unsigned int> nextDeque;
+    atomic<bool> running;
+
+    // Workers sleep on wakeCondition while no deque holds a task
+    atomic<size_t> queued;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+
+    // Submitted tasks that have not finished yet
+    atomic<size_t> unfinished;
+    std::mutex idleMutex;
+    std::condition_variable idleCondition;
+};
+
+#endif
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <mqtt/async_client.h>
+#include "loadGenerator.h"
+#include "../common/latencyHistogram.h"
+#include "../common/mqttTransport.h"
+using namespace std;
+
+// Progress of every publisher thread of a region, read by the reporter
+struct LoadCounters
+{
+    atomic<uint64_t> requestsSent{0};
+    atomic<uint64_t> messagesSent{0};
+    atomic<uint64_t> messagesAcknowledged{0};
+    atomic<uint64_t> messagesFailed{0};
+    // Publish latencies in microseconds
+    LatencyHistogram latency;
+};
+
+// One connection to the broker publishing a share of the region's target
+// rate. Publishes are pipelined: a thread keeps up to window messages on the
+// wire and only blocks once all of them wait for their acknowledgement
+class LoadPublisher : public mqtt::iaction_listener
+{
+public:
+    LoadPublisher(const string &regionName, int index, unsigned int seed, const LoadOptions &options, LoadCounters &counters);
+    void connect();
+    // Publishes from start until end, then waits for the outstanding
+    // acknowledgements and disconnects
+    void run(chrono::steady_clock::time_point start, chrono::steady_clock::time_point end);
+    void on_success(const mqtt::token &token) override;
+    void on_failure(const mqtt::token &token) override;
+
+private:
+    // Returns -1 if no slot frees up before the deadline
+    int acquireSlot(chrono::steady_clock::time_point deadline);
+    void releaseSlot(int slot);
+
+    string regionName;
+    int index;
+    const LoadOptions &options;
+    LoadCounters &counters;
+    TrafficProfile::TrafficGenerator generator;
+    uint64_t nextRequestId;
+    vector<RequestMessage> batch;
+    // One message and send time per in-flight slot. The client is done with
+    // the message of a slot once its publish is acknowledged, so the messages
+    // are allocated once and reused
+    vector<mqtt::message_ptr> messages;
+    vector<chrono::steady_clock::time_point> sentAt;
+    mutex slotsMutex;
+    condition_variable slotFreed;
+    vector<int> freeSlots;
+    unique_ptr<mqtt::async_client> client;
+};
+
+//////////////////
+// Load publisher class implementation
+LoadPublisher::LoadPublisher(const string &regionName, int index, unsigned int seed, const LoadOptions &options, LoadCounters &counters)
+    : options(options), counters(counters), generator(options.profile, seed)
+{
+    this->regionName = regionName;
+    this->index = index;
+    // Request ids stay unique across the threads of a region
+    nextRequestId = (uint64_t)index << 48;
+    batch.resize(options.batchSize);
+    for (int slot = 0; slot < options.window; ++slot)
+    {
+        messages.push_back(mqtt::make_message(regionName, "", options.qos, false));
+        freeSlots.push_back(slot);
+    }
+    sentAt.resize(options.window);
+}
+
+void LoadPublisher::connect()
+{
+    client = make_unique<mqtt::async_client>("localhost:1883", "load_" + regionName + "_" + to_string(index),
+                                             mqtt::create_options(MQTTVERSION_5));
+    mqtt::connect_options connectOptions;
+    connectOptions.set_mqtt_version(MQTTVERSION_5);
+    connectOptions.set_clean_start(true);
+    // Let the client keep the whole window of QoS 1 and 2 publishes in flight
+    connectOptions.set_max_inflight(options.window);
+    client->connect(connectOptions)->wait();
+}
+
+void LoadPublisher::run(chrono::steady_clock::time_point start, chrono::steady_clock::time_point end)
+{
+    // Each thread keeps its own schedule of messages, sleeping until the next
+    // one is due. A thread that falls more than a second behind drops the
+    // backlog instead of bursting it out, the report shows the shortfall
+    double messageRate = options.targetRate / options.threadsPerRegion / options.batchSize;
+    auto interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(messageRate > 0 ? 1 / messageRate : 0));
+    auto next = start;
+    while (true)
+    {
+        auto now = chrono::steady_clock::now();
+        if (now >= end)
+        {
+            break;
+        }
+        if (messageRate > 0)
+        {
+            if (next > now)
+            {
+                this_thread::sleep_until(std::min(next, end));
+                continue;
+            }
+            if (now - next > chrono::seconds(1))
+            {
+                next = now;
+            }
+        }
+
+        int slot = acquireSlot(end);
+        if (slot == -1)
+        {
+            break;
+        }
+        for (auto &request : batch)
+        {
+            request = generator.nextRequest(nextRequestId++);
+        }
+        messages[slot]->set_payload(batch.data(), batch.size() * sizeof(RequestMessage));
+        sentAt[slot] = chrono::steady_clock::now();
+        counters.messagesSent.fetch_add(1, memory_order_relaxed);
+        counters.requestsSent.fetch_add(batch.size(), memory_order_relaxed);
+        try
+        {
+            client->publish(messages[slot], reinterpret_cast<void *>((intptr_t)slot), *this);
+        }
+        catch (const mqtt::exception &)
+        {
+            counters.messagesFailed.fetch_add(1, memory_order_relaxed);
+            releaseSlot(slot);
+        }
+        next += interval;
+    }
+
+    // Give the broker a moment to acknowledge what is still on the wire
+    {
+        unique_lock<mutex> lock(slotsMutex);
+        slotFreed.wait_for(lock, chrono::seconds(10), [this]
+                           { return (int)freeSlots.size() == options.window; });
+    }
+    client->disconnect()->wait();
+}
+
+int LoadPublisher::acquireSlot(chrono::steady_clock::time_point deadline)
+{
+    unique_lock<mutex> lock(slotsMutex);
+    if (!slotFreed.wait_until(lock, deadline, [this]
+                              { return !freeSlots.empty(); }))
+    {
+        return -1;
+    }
+    int slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+}
+
+void LoadPublisher::releaseSlot(int slot)
+{
+    {
+        lock_guard<mutex> lock(slotsMutex);
+        freeSlots.push_back(slot);
+    }
+    slotFreed.notify_one();
+}
+
+void LoadPublisher::on_success(const mqtt::token &token)
+{
+    int slot = (int)reinterpret_cast<intptr_t>(token.get_user_context());
+    auto latency = chrono::steady_clock::now() - sentAt[slot];
+    counters.latency.record(chrono::duration_cast<chrono::microseconds>(latency).count());
+    counters.messagesAcknowledged.fetch_add(1, memory_order_relaxed);
+    releaseSlot(slot);
+}
+
+void LoadPublisher::on_failure(const mqtt::token &token)
+{
+    int slot = (int)reinterpret_cast<intptr_t>(token.get_user_context());
+    counters.messagesFailed.fetch_add(1, memory_order_relaxed);
+    releaseSlot(slot);
+}
+
+static string formatMs(uint64_t micros)
+{
+    ostringstream text;
+    text << fixed << setprecision(2) << micros / 1000.0 << " ms";
+    return text.str();
+}
+
+void generateLoad(string regionName, unsigned int seed, LoadOptions options)
+{
+    LoadCounters counters;
+    vector<unique_ptr<LoadPublisher>> publishers;
+    for (int i = 0; i < options.threadsPerRegion; ++i)
+    {
+        publishers.push_back(make_unique<LoadPublisher>(regionName, i, seed + i, options, counters));
+        publishers.back()->connect();
+    }
+
+    // Every thread starts on the same clock once all of them are connected
+    auto start = chrono::steady_clock::now();
+    auto end = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(options.durationSeconds));
+    vector<thread> threads;
+    for (auto &publisher : publishers)
+    {
+        threads.emplace_back(&LoadPublisher::run, publisher.get(), start, end);
+    }
+
+    // Report the rate and latency of every second of the run
+    uint64_t lastRequests = 0;
+    uint64_t lastAcknowledged = 0;
+    uint64_t lastSamples = 0;
+    uint64_t lastLatencyMicros = 0;
+    for (auto reportAt = start + chrono::seconds(1); reportAt <= end; reportAt += chrono::seconds(1))
+    {
+        this_thread::sleep_until(reportAt);
+        uint64_t requests = counters.requestsSent.load(memory_order_relaxed);
+        uint64_t sent = counters.messagesSent.load(memory_order_relaxed);
+        uint64_t acknowledged = counters.messagesAcknowledged.load(memory_order_relaxed);
+        uint64_t failed = counters.messagesFailed.load(memory_order_relaxed);
+        uint64_t samples = counters.latency.samples();
+        uint64_t latencyMicros = counters.latency.total();
+
+        ostringstream line;
+        line << regionName << "\t" << requests - lastRequests << " requests/s (target " << options.targetRate << ")"
+             << "\t" << acknowledged - lastAcknowledged << " acknowledged/s"
+             << "\t" << sent - acknowledged - failed << " in flight"
+             << "\tlatency avg " << formatMs(samples > lastSamples ? (latencyMicros - lastLatencyMicros) / (samples - lastSamples) : 0) << "\n";
+        cout << line.str();
+        lastRequests = requests;
+        lastAcknowledged = acknowledged;
+        lastSamples = samples;
+        lastLatencyMicros = latencyMicros;
+    }
+
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    uint64_t requests = counters.requestsSent.load();
+    uint64_t samples = counters.latency.samples();
+    ostringstream summary;
+    summary << regionName << " done: " << requests << " requests in " << counters.messagesSent.load() << " messages over "
+            << options.durationSeconds << " s, " << (uint64_t)(requests / options.durationSeconds) << " requests/s (target "
+            << options.targetRate << "), " << counters.messagesFailed.load() << " failed\n"
+            << regionName << " publish latency: avg " << formatMs(samples > 0 ? counters.latency.total() / samples : 0)
+            << " p50 " << formatMs(counters.latency.percentile(0.5))
+            << " p99 " << formatMs(counters.latency.percentile(0.99))
+            << " p99.9 " << formatMs(counters.latency.percentile(0.999))
+            << " max " << formatMs(counters.latency.max()) << "\n";
+    cout << summary.str();
+
+    if (options.endOfDay)
+    {
+        MqttTransport transport;
+        transport.createPublisher("load_" + regionName + "_end", regionName)->publish("END OF DAY");
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef LOAD_GENERATOR
+#define LOAD_GENERATOR
+#include <string>
+#include "../common/trafficProfile.h"
+using namespace std;
+
+// Settings of a load run. Unlike the request generator a load run ignores the
+// pauses of the traffic profile, the rate controller decides when to publish
+// and the profile only shapes the requests themselves
+struct LoadOptions
+{
+    // Requests per second per region over all its publisher threads, 0
+    // publishes as fast as the in-flight window allows
+    double targetRate = 10000;
+    int threadsPerRegion = 2;
+    // Publishes a thread may have on the wire before it waits for one to be
+    // acknowledged
+    int window = 256;
+    // Requests packed into one message, the receiver places each of them
+    int batchSize = 1;
+    double durationSeconds = 10;
+    int qos = 0;
+    // Publish END OF DAY once every request is acknowledged so the consumer
+    // writes its report for the run
+    bool endOfDay = false;
+    TrafficProfile::Profile profile;
+};
+
+// Floods the topic of the region for the duration of the run, printing the
+// achieved rate and publish latency every second and a summary at the end
+void generateLoad(string regionName, unsigned int seed, LoadOptions options);
+
+#endif
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <iostream>
+#include "loadGenerator.h"
+#include <vector>
+#include <thread>
+#include <random>
+#include <string>
+using namespace std;
+
+// Usage: loadGenerator [--rate=N] [--threads=N] [--window=N] [--batch=N] [--seconds=N] [--qos=0|1|2]
+//                      [--seed=N] [--end-of-day]
+// Publishes requests to every region as fast as the target rate asks, to
+// stress the consumer. The rate is in requests per second per region, 0 runs
+// unthrottled
+int main(int argc, char *argv[])
+{
+    unsigned int seed = random_device()();
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (option.rfind("--rate=", 0) == 0)
+        {
+            options.targetRate = std::max(0.0, stod(option.substr(7)));
+        }
+        else if (option.rfind("--threads=", 0) == 0)
+        {
+            options.threadsPerRegion = std::max(1, stoi(option.substr(10)));
+        }
+        else if (option.rfind("--window=", 0) == 0)
+        {
+            options.window = std::max(1, stoi(option.substr(9)));
+        }
+        else if (option.rfind("--batch=", 0) == 0)
+        {
+            options.batchSize = std::max(1, stoi(option.substr(8)));
+        }
+        else if (option.rfind("--seconds=", 0) == 0)
+        {
+            options.durationSeconds = std::max(1.0, stod(option.substr(10)));
+        }
+        else if (option.rfind("--qos=", 0) == 0)
+        {
+            options.qos = std::clamp(stoi(option.substr(6)), 0, 2);
+        }
+        else if (option.rfind("--seed=", 0) == 0)
+        {
+            seed = stoul(option.substr(7));
+        }
+        else if (option == "--end-of-day")
+        {
+            options.endOfDay = true;
+        }
+        else
+        {
+            cerr << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+
+    cout << "Generating " << options.targetRate << " requests/s per region for " << options.durationSeconds << " s...\n";
+
+    vector<string> regions = {"Oregon", "London", "Singapore"};
+    vector<thread> threads;
+
+    // The publisher threads of region i draw their requests from seeds
+    // seed + i * threads onwards, so no two threads repeat each other
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        threads.emplace_back(generateLoad, regions[i], seed + i * options.threadsPerRegion, options);
+    }
+
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    return 0;
+}
@@ -1,20 +1,90 @@
 #include <iostream>
 #include "requestGenerator.h"
+#include "../common/mqttTransport.h"
+#include <algorithm>
 #include <vector>
 #include <thread>
+#include <random>
+#include <string>
 using namespace std;
 
-int main() {
+// Usage: requestGenerator [--seed=N] [--traffic=uniform|poisson|diurnal|bursty]
+//                         [--phases=end:minPause-maxPause,...] [--record=prefix] [--replay=prefix]
+//                         [--priorities=high:share,low:share] [--max-wait=ms]
+// Without a seed every run draws different traffic, with one region i uses seed + i.
+// --priorities marks those shares of the requests high and low priority and
+// --max-wait sets how long a request may wait for a region at its fleet limits
+int main(int argc, char *argv[]) {
+    unsigned int seed = random_device()();
+    ArrivalOptions arrivals;
+    for (int i = 1; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (option.rfind("--seed=", 0) == 0)
+        {
+            seed = stoul(option.substr(7));
+        }
+        else if (option.rfind("--traffic=", 0) == 0)
+        {
+            auto model = TrafficProfile::parseArrivalModel(option.substr(10));
+            if (!model)
+            {
+                cerr << "Unknown traffic model: " << option.substr(10) << endl;
+                return 1;
+            }
+            arrivals.profile.model = *model;
+        }
+        else if (option.rfind("--phases=", 0) == 0)
+        {
+            auto phases = TrafficProfile::parsePhases(option.substr(9));
+            if (!phases)
+            {
+                cerr << "Invalid traffic phases: " << option.substr(9) << endl;
+                return 1;
+            }
+            arrivals.profile.phases = *phases;
+        }
+        else if (option.rfind("--priorities=", 0) == 0)
+        {
+            auto shares = TrafficProfile::parsePriorityShares(option.substr(13));
+            if (!shares)
+            {
+                cerr << "Invalid priority shares: " << option.substr(13) << endl;
+                return 1;
+            }
+            arrivals.profile.highPriorityShare = shares->first;
+            arrivals.profile.lowPriorityShare = shares->second;
+        }
+        else if (option.rfind("--max-wait=", 0) == 0)
+        {
+            arrivals.profile.maxWaitMs = std::max(0, stoi(option.substr(11)));
+        }
+        else if (option.rfind("--record=", 0) == 0)
+        {
+            arrivals.recordPrefix = option.substr(9);
+        }
+        else if (option.rfind("--replay=", 0) == 0)
+        {
+            arrivals.replayPrefix = option.substr(9);
+        }
+        else
+        {
+            cerr << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+
     cout << "Starting 200x day simulation...\n";
 
     // Define the regions you want to simulate
     vector<string> regions = {"Oregon", "London", "Singapore"};
     // Create a vector to store the threads
     vector<thread> threads;
+    MqttTransport transport;
 
     // Launch a thread for each region
-    for (const auto& region : regions) {
-        threads.emplace_back(generateRequests, region);  // Pass the region name to each thread
+    for (size_t i = 0; i < regions.size(); ++i) {
+        threads.emplace_back(generateRequests, regions[i], seed + i, arrivals, std::ref(transport));  // Pass the region name to each thread
     }
 
 
@@ -24,4 +94,4 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
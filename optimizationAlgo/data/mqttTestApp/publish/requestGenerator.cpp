@@ -1,24 +1,21 @@
 #include <iostream>
-#include <random>
-#include <mqtt/client.h>
-#include "mqttPublishMessage.h"
+#include "requestGenerator.h"
+#include "../common/trafficProfile.h"
 #include <chrono>
 #include <thread>
+#include <string_view>
 using namespace std;
 
-void generateRequests(string regionName)
+// Publishes the arrivals of the region in real time. A replay ends its last
+// day when the trace runs out, like the discrete-event simulation does
+void generateRequests(string regionName, unsigned int seed, ArrivalOptions arrivals, Transport &transport)
 {
-    // Set up random number generation
-    random_device rd;
-    mt19937 gen(rd());
+    RequestSource requestSource(regionName, seed, arrivals);
 
-    // Define high and low traffic frequency ranges for random durations
-    uniform_int_distribution<> lowTrafficDis(10000, 20000); // In real life between 33 minute to 66 minutes a request
-    uniform_int_distribution<> highTrafficDis(1000, 2000);  // In real life between 3.3 minute to 6.6 minutes a request
-
-    auto client = initiatePubClient("publish_" + regionName);
-    // Initialize an empty message with specified topic.
-    mqtt::message_ptr timeLeftMessagePointer = mqtt::make_message(regionName, "");
+    auto publisher = transport.createPublisher("publish_" + regionName, regionName);
+    // The region asks to hold requests back while its admission queue is nearly full
+    auto backpressure = transport.createSubscriber("throttle_" + regionName, backpressureTopic(regionName));
+    bool paused = false;
 
     // Start timer to track how long the program has been running
     auto start = chrono::steady_clock::now();
@@ -29,31 +26,47 @@ void generateRequests(string regionName)
         auto now = chrono::steady_clock::now();
         auto elapsed = chrono::duration_cast<chrono::seconds>(now - start).count();
 
-        // Choose distribution based on elapsed time
-        int randomPause;
-        if (elapsed < 144)
+        bool dayEnded = TrafficProfile::isEndOfDay(elapsed);
+        if (dayEnded)
         {
-            randomPause = lowTrafficDis(gen);
+            publisher->publish("END OF DAY");
+            cout << "END OF DAY" << endl;
+            start = chrono::steady_clock::now();
         }
-        else if (elapsed < 288)
+
+        // While requests are held back it waits in short steps, the day goes
+        // on and END OF DAY still goes out on time
+        ReceivedMessage signal;
+        while (backpressure->tryReceive(signal) || (paused && backpressure->receive(signal, chrono::milliseconds(100))))
         {
-            randomPause = highTrafficDis(gen);
+            std::string_view signalText(signal.data, signal.size);
+            if (signalText == "PAUSE" || signalText == "RESUME")
+            {
+                paused = signalText == "PAUSE";
+                cout << regionName << (paused ? " holds back requests" : " takes requests again") << endl;
+            }
         }
-        else if (elapsed <= 432)
+        if (paused)
         {
-            randomPause = lowTrafficDis(gen);
+            continue;
         }
-        else
+
+        // The pause depends on the traffic phase of the elapsed time
+        RequestMessage request;
+        int randomPause;
+        if (!requestSource.next(elapsed, request, randomPause))
         {
-            publishMessage("END OF DAY", *client, timeLeftMessagePointer);
-            cout << "END OF DAY" << endl;
-            start = chrono::steady_clock::now();
-            randomPause = lowTrafficDis(gen);
+            if (!dayEnded)
+            {
+                publisher->publish("END OF DAY");
+            }
+            cout << "Trace of " << regionName << " replayed" << endl;
+            break;
         }
-
-        string payload = "Elapsed:" + to_string(elapsed) + "\tRegion: " + regionName + "=" + to_string(randomPause);
-        cout << payload << endl;
-        publishMessage(payload, *client, timeLeftMessagePointer);
+        requestSource.flush();
+        cout << "Elapsed:" << elapsed << "\tRegion: " << regionName << "=" << randomPause
+             << "\tRequest: " << request.requestId << " " << request.durationMs << "ms" << endl;
+        publisher->publish(&request, sizeof(request));
 
         // Pause the program for the random duration
         this_thread::sleep_for(chrono::milliseconds(randomPause));
@@ -1,6 +1,9 @@
 #ifndef MY_CLASS_Ho
 #define MY_CLASS_Ho
+#include <string>
+#include "../common/requestSource.h"
+#include "../common/transport.h"
 
-void generateRequests(std::string regionName);
+void generateRequests(std::string regionName, unsigned int seed, ArrivalOptions arrivals, Transport &transport);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,115 @@
+#include <iterator>
+#include "admissionQueue.h"
+using namespace std;
+
+// Priority classes from the most to the least urgent
+static constexpr RequestPriority priorityByUrgency[requestPriorityCount] = {RequestPriority::High, RequestPriority::Standard, RequestPriority::Low};
+
+static int urgencyOf(const RequestMessage &request)
+{
+    switch (requestPriority(request))
+    {
+    case RequestPriority::High:
+        return 0;
+    case RequestPriority::Standard:
+        return 1;
+    case RequestPriority::Low:
+        break;
+    }
+    return 2;
+}
+
+bool AdmissionQueue::MoreUrgent::operator()(const QueuedRequest &a, const QueuedRequest &b) const
+{
+    int urgencyA = urgencyOf(a.request);
+    int urgencyB = urgencyOf(b.request);
+    if (urgencyA != urgencyB)
+    {
+        return urgencyA < urgencyB;
+    }
+    if (a.deadline != b.deadline)
+    {
+        return a.deadline < b.deadline;
+    }
+    return a.sequence < b.sequence;
+}
+
+//////////////////
+// Admission queue class implementation
+AdmissionQueue::AdmissionQueue(size_t capacityInput)
+{
+    capacity = capacityInput;
+    nextSequence = 0;
+    queued = 0;
+}
+
+AdmissionResult AdmissionQueue::push(const RequestMessage &request, std::chrono::steady_clock::time_point now, QueuedRequest &displaced)
+{
+    QueuedRequest entry;
+    entry.request = request;
+    entry.enqueuedAt = now;
+    entry.deadline = request.maxWaitMs > 0 ? now + chrono::milliseconds(request.maxWaitMs) : std::chrono::steady_clock::time_point::max();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entry.sequence = nextSequence++;
+    if (requests.size() < capacity)
+    {
+        requests.insert(entry);
+        queued.store(requests.size(), memory_order_relaxed);
+        return AdmissionResult::Queued;
+    }
+    // Full: whichever of the newcomer and the least urgent waiting request
+    // ranks lower is turned away
+    if (requests.empty() || !MoreUrgent()(entry, *std::prev(requests.end())))
+    {
+        return AdmissionResult::Rejected;
+    }
+    displaced = *std::prev(requests.end());
+    requests.erase(std::prev(requests.end()));
+    requests.insert(entry);
+    return AdmissionResult::QueuedDisplacing;
+}
+
+bool AdmissionQueue::pop(std::chrono::steady_clock::time_point now, QueuedRequest &next, int (&expired)[requestPriorityCount])
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    // Each class is ordered by deadline, so its expired requests are at its front
+    for (RequestPriority priority : priorityByUrgency)
+    {
+        QueuedRequest first{};
+        setRequestPriority(first.request, priority);
+        first.deadline = std::chrono::steady_clock::time_point::min();
+        auto request = requests.lower_bound(first);
+        while (request != requests.end() && requestPriority(request->request) == priority && request->deadline < now)
+        {
+            ++expired[static_cast<int>(priority)];
+            request = requests.erase(request);
+        }
+    }
+    queued.store(requests.size(), memory_order_relaxed);
+    if (requests.empty())
+    {
+        return false;
+    }
+    next = *requests.begin();
+    requests.erase(requests.begin());
+    queued.store(requests.size(), memory_order_relaxed);
+    return true;
+}
+
+void AdmissionQueue::requeue(const QueuedRequest &request)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    requests.insert(request);
+    queued.store(requests.size(), memory_order_relaxed);
+}
+
+size_t AdmissionQueue::size() const
+{
+    return queued.load(memory_order_relaxed);
+}
+
+size_t AdmissionQueue::getCapacity() const
+{
+    return capacity;
+}
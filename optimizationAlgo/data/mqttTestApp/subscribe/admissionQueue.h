@@ -0,0 +1,67 @@
+#ifndef ADMISSION_QUEUE
+#define ADMISSION_QUEUE
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include "../common/requestMessage.h"
+using namespace std;
+
+// A request that found no room in a region at its fleet limits
+struct QueuedRequest
+{
+    RequestMessage request;
+    std::chrono::steady_clock::time_point enqueuedAt;
+    // When waiting longer is no use, time_point::max() for never
+    std::chrono::steady_clock::time_point deadline;
+    // Arrival order, requests that are otherwise equal leave first in first out
+    uint64_t sequence;
+};
+
+enum class AdmissionResult
+{
+    Queued,
+    // Queued in place of a less urgent request, which was turned away
+    QueuedDisplacing,
+    // The queue is full of requests at least as urgent, turned away
+    Rejected,
+};
+
+// Requests of a region waiting for its fleet to free up capacity. The most
+// urgent one leaves first: high before standard before low priority, and
+// within a class the earliest deadline. It is bounded so a burst cannot queue
+// without limit. Every shard shares it, so it takes its own mutex, always
+// after the shard mutex
+class AdmissionQueue
+{
+public:
+    explicit AdmissionQueue(size_t capacityInput);
+    // Queues the request. When the queue is full the least urgent request is
+    // turned away, which may be this one. displaced is filled when another one was
+    AdmissionResult push(const RequestMessage &request, std::chrono::steady_clock::time_point now, QueuedRequest &displaced);
+    // Takes the most urgent request into next, false if none is left.
+    // Requests whose deadline passed are dropped on the way and counted in
+    // expired per priority class
+    bool pop(std::chrono::steady_clock::time_point now, QueuedRequest &next, int (&expired)[requestPriorityCount]);
+    // Puts back a request that pop returned and that still found no room, it keeps its place
+    void requeue(const QueuedRequest &request);
+    // Read without the mutex, so placement can skip an empty queue for free
+    size_t size() const;
+    size_t getCapacity() const;
+
+private:
+    struct MoreUrgent
+    {
+        bool operator()(const QueuedRequest &a, const QueuedRequest &b) const;
+    };
+
+    std::mutex mutex;
+    std::set<QueuedRequest, MoreUrgent> requests;
+    size_t capacity;
+    uint64_t nextSequence;
+    atomic<size_t> queued;
+};
+
+#endif
@@ -2,7 +2,7 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
-#include <map>
+#include <cstdint>
 #include <string>
 #include <optional>
 #include <cmath> // For std::ceil
@@ -20,6 +20,14 @@ inline constexpr double memoryConstant = 3; // GB
 inline constexpr double logicalProcessorConstant = 2.2; // vCPU or Logical Processors
 inline constexpr double averageApplicationExecutionDuration = 60; // seconds. 200 minutes in real life
 
+// Simulated durations are this many times shorter than in real life
+inline constexpr float timeCompressionFactor = 200;
+
+// How long the message receiver blocks waiting for a message, and the most
+// messages it drains from the queue before placing them
+inline constexpr int receiveTimeoutMs = 500;
+inline constexpr int maxReceiveBatch = 256;
+
 // Function declarations
 inline int vCPUReqCalculator(int totalProcessNum) {
     double estimateRequirement = logicalProcessorCoefficient * (totalProcessNum - 1) + logicalProcessorConstant;
@@ -31,35 +39,54 @@ inline int memoryReqCalculator(int totalProcessNum) {
     return std::ceil(estimateRequirement);
 }
 
-// Average regional service pricing in USD
-inline const std::map<std::string, float> oregonServerPricing = {
-    {"c08", 0.2859},
-    {"c16", 0.5719},
-    {"c32", 1.1437},
-    {"c52", 1.8655},
-    {"c88", 3.1869},
+// Instance types from smallest to largest, the order is the vertical scaling ladder
+enum class InstanceType : uint8_t {
+    c08,
+    c16,
+    c32,
+    c52,
+    c88,
 };
+inline constexpr int instanceTypeCount = 5;
 
-inline const std::map<std::string, float> londonServerPricing = {
-    {"c08", 0.3547},
-    {"c16", 0.7095},
-    {"c32", 1.4190},
-    {"c52", 2.3217},
-    {"c88", 3.9969},
+enum class Region : uint8_t {
+    Oregon,
+    London,
+    Singapore,
 };
+inline constexpr int regionCount = 3;
+
+// Names used in messages, logs and reports, indexed by the enums above
+inline constexpr const char *instanceTypeNames[instanceTypeCount] = {"c08", "c16", "c32", "c52", "c88"};
+inline constexpr const char *regionNames[regionCount] = {"Oregon", "London", "Singapore"};
+
+inline constexpr int toIndex(InstanceType instanceType) {
+    return static_cast<int>(instanceType);
+}
+
+inline constexpr int toIndex(Region region) {
+    return static_cast<int>(region);
+}
 
-inline const std::map<std::string, float> singaporeServerPricing = {
-    {"c08", 0.3412},
-    {"c16", 0.6824},
-    {"c32", 1.3648},
-    {"c52", 2.2316},
-    {"c88", 3.8360},
+// Average regional service pricing in USD per hour, indexed by [region][instance type]
+inline constexpr float serverPricing[regionCount][instanceTypeCount] = {
+    // Oregon
+    {0.2859, 0.5719, 1.1437, 1.8655, 3.1869},
+    // London
+    {0.3547, 0.7095, 1.4190, 2.3217, 3.9969},
+    // Singapore
+    {0.3412, 0.6824, 1.3648, 2.2316, 3.8360},
 };
 
-inline const std::map<std::string, std::map<std::string, float>>  overallServerPricing = {
-    {"Oregon", oregonServerPricing},
-    {"London", oregonServerPricing},
-    {"Singapore", oregonServerPricing}
+// Typical round trip latency in milliseconds between the regions, indexed by
+// [from region][to region]
+inline constexpr float interRegionLatencyMs[regionCount][regionCount] = {
+    // Oregon
+    {0, 135, 160},
+    // London
+    {135, 0, 170},
+    // Singapore
+    {160, 170, 0},
 };
 
 struct Capacity {
@@ -69,29 +96,75 @@ struct Capacity {
 };
 
 // Server process capacities per type
-inline const std::map<std::string, Capacity> processCapacityPerInstanceType = {
-    {"c08", {2, 3, 5}},
-    {"c16", {3, 7, 10}},
-    {"c32", {5, 19, 22}},
-    {"c52", {15, 33, 36}},
-    {"c88", {28, 58, 62}}
+inline constexpr Capacity processCapacityPerInstanceType[instanceTypeCount] = {
+    {2, 3, 5},    // c08
+    {3, 7, 10},   // c16
+    {5, 19, 22},  // c32
+    {15, 33, 36}, // c52
+    {28, 58, 62}, // c88
 };
 
+// Resources of each instance type. c-family instances have 2 GB per vCPU
+inline constexpr int vCpuPerInstanceType[instanceTypeCount] = {8, 16, 32, 52, 88};
+inline constexpr int memoryGbPerInstanceType[instanceTypeCount] = {16, 32, 64, 104, 176};
+
+// Part of vCPUReqCalculator and memoryReqCalculator that does not grow with
+// the process count, i.e. what the server itself uses
+inline constexpr int serverOverheadVcpuMilli = static_cast<int>((logicalProcessorConstant - logicalProcessorCoefficient) * 1000 + 0.5);
+inline constexpr int serverOverheadMemoryMb = static_cast<int>((memoryConstant - memoryCoefficient) * 1024 + 0.5);
+
+inline constexpr float priceOf(Region region, InstanceType instanceType) {
+    return serverPricing[toIndex(region)][toIndex(instanceType)];
+}
+
+inline constexpr const Capacity &capacityOf(InstanceType instanceType) {
+    return processCapacityPerInstanceType[toIndex(instanceType)];
+}
+
+// Resources left for processes once the server overhead is taken out
+inline constexpr int usableVcpuMilli(InstanceType instanceType) {
+    return vCpuPerInstanceType[toIndex(instanceType)] * 1000 - serverOverheadVcpuMilli;
+}
+
+inline constexpr int usableMemoryMb(InstanceType instanceType) {
+    return memoryGbPerInstanceType[toIndex(instanceType)] * 1024 - serverOverheadMemoryMb;
+}
+
+inline constexpr InstanceType largestInstanceType = static_cast<InstanceType>(instanceTypeCount - 1);
+
 // Returns the next larger instance type, or nullopt if already at largest
-std::optional<std::string> getNextInstanceType(const std::string& currentType) {
-    // Find current type in map
-    auto currentIt = processCapacityPerInstanceType.find(currentType);
-    if (currentIt == processCapacityPerInstanceType.end()) {
-        return std::nullopt;  // Current type not found
+inline constexpr std::optional<InstanceType> getNextInstanceType(InstanceType currentType) {
+    if (currentType == largestInstanceType) {
+        return std::nullopt;  // Already at largest instance type
     }
+    return static_cast<InstanceType>(toIndex(currentType) + 1);
+}
 
-    // Try to get next element
-    auto nextIt = std::next(currentIt);
-    if (nextIt == processCapacityPerInstanceType.end()) {
-        return std::nullopt;  // Already at largest instance type
+inline const char *instanceTypeName(InstanceType instanceType) {
+    return instanceTypeNames[toIndex(instanceType)];
+}
+
+inline const char *regionName(Region region) {
+    return regionNames[toIndex(region)];
+}
+
+// Conversions from names at the I/O boundary, nullopt for unknown names
+inline std::optional<InstanceType> parseInstanceType(const std::string &name) {
+    for (int i = 0; i < instanceTypeCount; ++i) {
+        if (name == instanceTypeNames[i]) {
+            return static_cast<InstanceType>(i);
+        }
     }
+    return std::nullopt;
+}
 
-    return nextIt->first;  // Return the next instance type
+inline std::optional<Region> parseRegion(const std::string &name) {
+    for (int i = 0; i < regionCount; ++i) {
+        if (name == regionNames[i]) {
+            return static_cast<Region>(i);
+        }
+    }
+    return std::nullopt;
 }
 
 } // namespace Constants
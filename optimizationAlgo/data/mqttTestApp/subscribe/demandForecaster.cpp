@@ -0,0 +1,72 @@
+#include <algorithm>
+#include "demandForecaster.h"
+using namespace std;
+
+//////////////////
+// Demand forecaster class implementation
+DemandForecaster::DemandForecaster(int intervalsPerDayInput, double levelSmoothingInput, double trendSmoothingInput, double seasonalSmoothingInput)
+{
+    intervalsPerDay = max(1, intervalsPerDayInput);
+    levelSmoothing = levelSmoothingInput;
+    trendSmoothing = trendSmoothingInput;
+    seasonalSmoothing = seasonalSmoothingInput;
+    level = 0;
+    trend = 0;
+    seasonal.assign(intervalsPerDay, 0);
+    position = 0;
+    observations = 0;
+}
+
+void DemandForecaster::observe(double arrivals)
+{
+    double &season = seasonal[position];
+    if (observations == 0)
+    {
+        level = arrivals;
+    }
+    else if (observations < intervalsPerDay)
+    {
+        // During the first day there is no seasonal history yet, track the
+        // level and record how each interval differs from it
+        double previousLevel = level;
+        level = levelSmoothing * arrivals + (1 - levelSmoothing) * (level + trend);
+        trend = trendSmoothing * (level - previousLevel) + (1 - trendSmoothing) * trend;
+        season = arrivals - level;
+    }
+    else
+    {
+        double previousLevel = level;
+        level = levelSmoothing * (arrivals - season) + (1 - levelSmoothing) * (level + trend);
+        trend = trendSmoothing * (level - previousLevel) + (1 - trendSmoothing) * trend;
+        season = seasonalSmoothing * (arrivals - level) + (1 - seasonalSmoothing) * season;
+    }
+
+    ++observations;
+    position = (position + 1) % intervalsPerDay;
+}
+
+double DemandForecaster::forecast(int stepsAhead)
+{
+    if (observations == 0)
+    {
+        return 0;
+    }
+    int seasonIndex = (position + stepsAhead - 1) % intervalsPerDay;
+    double seasonalTerm = observations >= intervalsPerDay ? seasonal[seasonIndex] : 0;
+    return max(0.0, level + stepsAhead * trend + seasonalTerm);
+}
+
+double DemandForecaster::forecastTotal(int intervals)
+{
+    double total = 0;
+    for (int step = 1; step <= intervals; ++step)
+    {
+        total += forecast(step);
+    }
+    return total;
+}
+
+void DemandForecaster::beginDay()
+{
+    position = 0;
+}
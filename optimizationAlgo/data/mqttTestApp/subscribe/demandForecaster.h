@@ -0,0 +1,38 @@
+#ifndef DEMAND_FORECASTER
+#define DEMAND_FORECASTER
+#include <vector>
+using namespace std;
+
+// Forecasts request arrivals per interval with additive Holt-Winters
+// smoothing. The level and trend follow the recent arrival rate, and one
+// seasonal term per interval of the day learns the recurring low, high, low
+// traffic phases, so the ramp into the busy phase is anticipated from the
+// previous days instead of only being noticed once it has started
+class DemandForecaster
+{
+public:
+    DemandForecaster(int intervalsPerDayInput, double levelSmoothingInput = 0.3, double trendSmoothingInput = 0.05, double seasonalSmoothingInput = 0.3);
+    // Feed the number of arrivals of the interval that just ended
+    void observe(double arrivals);
+    // Expected arrivals in the interval stepsAhead intervals from now, 1 is the next one
+    double forecast(int stepsAhead);
+    // Expected arrivals summed over the next intervals
+    double forecastTotal(int intervals);
+    // Realign the seasonal terms with the start of a new day, days are not an
+    // exact number of intervals long
+    void beginDay();
+
+private:
+    int intervalsPerDay;
+    double levelSmoothing;
+    double trendSmoothing;
+    double seasonalSmoothing;
+    double level;
+    double trend;
+    vector<double> seasonal;
+    // Index of the interval of the day that the next observation belongs to
+    int position;
+    long observations;
+};
+
+#endif
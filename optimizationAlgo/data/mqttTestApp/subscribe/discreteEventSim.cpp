@@ -0,0 +1,129 @@
+#include "discreteEventSim.h"
+#include "../common/trafficProfile.h"
+using namespace std;
+
+//////////////////
+// Discrete event simulation class implementation
+DiscreteEventSimulation::DiscreteEventSimulation(string regionNameInput, unsigned int seed, RegionConfig config, const ArrivalOptions &arrivals)
+{
+    clock = std::make_shared<VirtualClock>();
+    addRegion(regionNameInput, seed, config, arrivals);
+}
+
+DiscreteEventSimulation::DiscreteEventSimulation(const vector<string> &regionNames, unsigned int seed, RegionConfig config, bool coordinate, const ArrivalOptions &arrivals)
+{
+    clock = std::make_shared<VirtualClock>();
+    for (size_t i = 0; i < regionNames.size(); ++i)
+    {
+        addRegion(regionNames[i], seed + i, config, arrivals);
+    }
+    if (coordinate)
+    {
+        coordinator = make_unique<GlobalCoordinator>();
+        for (auto &simulated : regions)
+        {
+            simulated.region->attachCoordinator(coordinator.get());
+        }
+    }
+}
+
+void DiscreteEventSimulation::addRegion(const string &regionName, unsigned int seed, const RegionConfig &config, const ArrivalOptions &arrivals)
+{
+    RegionConfig regionConfig = config;
+    // A simulation outruns any disk, wait for the event log instead of dropping events
+    regionConfig.dropEventsWhenFull = false;
+    SimulatedRegion simulated;
+    simulated.region = make_unique<RegionalAlgo>(regionName, regionConfig, clock);
+    simulated.arrivals = make_unique<RequestSource>(regionName, seed, arrivals);
+    simulated.dayStart = clock->now();
+    simulated.nextArrival = simulated.dayStart;
+    simulated.completedDays = 0;
+    regions.push_back(std::move(simulated));
+}
+
+// Generate and replay the arrivals of the given number of days. Each step
+// takes the region with the earliest next arrival and mirrors one iteration
+// of generateRequests for it: an END OF DAY event when its day is over, then
+// one request, then the pause to its next request. A region whose replayed
+// trace runs out ends its last day there
+void DiscreteEventSimulation::runDays(int days)
+{
+    for (;;)
+    {
+        SimulatedRegion *next = nullptr;
+        for (auto &simulated : regions)
+        {
+            if (simulated.completedDays < days && (next == nullptr || simulated.nextArrival < next->nextArrival))
+            {
+                next = &simulated;
+            }
+        }
+        if (next == nullptr)
+        {
+            break;
+        }
+
+        auto now = next->nextArrival;
+        long elapsed = chrono::duration_cast<chrono::seconds>(now - next->dayStart).count();
+
+        advanceTo(now);
+        bool dayEnded = TrafficProfile::isEndOfDay(elapsed);
+        if (dayEnded)
+        {
+            next->region->calculateCostBenefitRatio();
+            next->dayStart = now;
+            if (++next->completedDays == days)
+            {
+                continue;
+            }
+        }
+
+        RequestMessage request;
+        int pause;
+        if (!next->arrivals->next(elapsed, request, pause))
+        {
+            if (!dayEnded)
+            {
+                next->region->calculateCostBenefitRatio();
+            }
+            next->completedDays = days;
+            continue;
+        }
+        next->region->addProcessToServer(request);
+        next->nextArrival = now + chrono::milliseconds(pause);
+    }
+}
+
+RegionalAlgo &DiscreteEventSimulation::getRegion(size_t index)
+{
+    return *regions[index].region;
+}
+
+// Dispatch every scheduled event (process completions, server boots and
+// maintenance ticks) of every region up to the target time in deadline
+// order, then move the clock to the target. Events that share a timestamp
+// with an arrival are handled before the arrival
+void DiscreteEventSimulation::advanceTo(std::chrono::steady_clock::time_point target)
+{
+    for (;;)
+    {
+        RegionalAlgo *earliest = nullptr;
+        std::chrono::steady_clock::time_point earliestDeadline;
+        for (auto &simulated : regions)
+        {
+            std::chrono::steady_clock::time_point deadline;
+            if (simulated.region->nextEventDeadline(deadline) && deadline <= target && (earliest == nullptr || deadline < earliestDeadline))
+            {
+                earliest = simulated.region.get();
+                earliestDeadline = deadline;
+            }
+        }
+        if (earliest == nullptr)
+        {
+            break;
+        }
+        clock->advanceTo(earliestDeadline);
+        earliest->dispatchDueEvents();
+    }
+    clock->advanceTo(target);
+}
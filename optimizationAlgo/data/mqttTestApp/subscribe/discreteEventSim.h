@@ -0,0 +1,50 @@
+#ifndef DISCRETE_EVENT_SIM
+#define DISCRETE_EVENT_SIM
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../common/requestSource.h"
+#include "globalCoordinator.h"
+#include "messageReceiver.h"
+#include "regionConfig.h"
+#include "simClock.h"
+using namespace std;
+
+// Runs regions on a virtual clock. Request arrivals, process completions and
+// the end of each day are handled in timestamp order without sleeping, so a
+// simulated day takes as long as the placement work itself. The arrivals come
+// from the same request source as the request generator, so a seed or a
+// trace gives the same arrival sequence in both.
+// Several regions share one clock so a global coordinator can move requests
+// between them; each region keeps its own arrivals and days
+class DiscreteEventSimulation
+{
+public:
+    DiscreteEventSimulation(string regionNameInput, unsigned int seed, RegionConfig config = RegionConfig(), const ArrivalOptions &arrivals = ArrivalOptions());
+    // Region i draws its arrivals from seed + i, the same as a separate
+    // simulation per region. With coordinate the regions spill to each other
+    DiscreteEventSimulation(const vector<string> &regionNames, unsigned int seed, RegionConfig config = RegionConfig(), bool coordinate = false, const ArrivalOptions &arrivals = ArrivalOptions());
+    void runDays(int days);
+    RegionalAlgo &getRegion(size_t index = 0);
+
+private:
+    struct SimulatedRegion
+    {
+        unique_ptr<RegionalAlgo> region;
+        unique_ptr<RequestSource> arrivals;
+        std::chrono::steady_clock::time_point dayStart;
+        std::chrono::steady_clock::time_point nextArrival;
+        int completedDays;
+    };
+
+    void addRegion(const string &regionName, unsigned int seed, const RegionConfig &config, const ArrivalOptions &arrivals);
+    void advanceTo(std::chrono::steady_clock::time_point target);
+
+    std::shared_ptr<VirtualClock> clock;
+    // Declared before the regions so it outlives them
+    unique_ptr<GlobalCoordinator> coordinator;
+    vector<SimulatedRegion> regions;
+};
+
+#endif
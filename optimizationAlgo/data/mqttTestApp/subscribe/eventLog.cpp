@@ -0,0 +1,161 @@
+#include <cstring>
+#include <vector>
+#include "eventLog.h"
+using namespace std;
+
+// Events taken from the ring per write call
+static constexpr size_t writeBatchSize = 4096;
+
+//////////////////
+// Event log class implementation
+EventLog::EventLog(const string &path, size_t capacity, bool dropWhenFullInput)
+    : ring(capacity)
+{
+    enabled = !path.empty();
+    dropWhenFull = dropWhenFullInput;
+    running = true;
+    recorded = 0;
+    written = 0;
+    dropped = 0;
+    writerSleeping = false;
+    waitingRecorders = 0;
+    if (!enabled)
+    {
+        return;
+    }
+
+    file.open(path, std::ios::binary | std::ios::trunc);
+    EventLogHeader header;
+    memcpy(header.magic, eventLogMagic, sizeof(header.magic));
+    header.version = eventLogVersion;
+    header.recordSize = sizeof(FleetEvent);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    writerThread = thread(&EventLog::run, this);
+}
+
+EventLog::~EventLog()
+{
+    running = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    writerCondition.notify_one();
+    if (writerThread.joinable())
+    {
+        writerThread.join();
+    }
+}
+
+// A full ring either drops the event (real-time placement must not wait on
+// the disk) or waits for the writer (simulations need the complete log)
+void EventLog::record(const FleetEvent &event)
+{
+    if (!enabled)
+    {
+        return;
+    }
+    while (!ring.tryPush(event))
+    {
+        if (dropWhenFull)
+        {
+            ++dropped;
+            return;
+        }
+        wakeWriter();
+        std::unique_lock<std::mutex> lock(mutex);
+        waitingRecorders.fetch_add(1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (ring.size() >= ring.getCapacity())
+        {
+            spaceCondition.wait(lock);
+        }
+        waitingRecorders.fetch_sub(1, memory_order_relaxed);
+    }
+    ++recorded;
+    wakeWriter();
+}
+
+// Only take the mutex when the writer is actually asleep. The fence pairs with
+// the one in run() so that either the writer sees the new event or the
+// recorder sees the sleeping writer
+void EventLog::wakeWriter()
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (writerSleeping.load(memory_order_relaxed))
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        writerCondition.notify_one();
+    }
+}
+
+void EventLog::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    writtenCondition.wait(lock, [this]()
+                          { return written.load() >= recorded.load(); });
+}
+
+unsigned long long EventLog::getDroppedCount()
+{
+    return dropped.load();
+}
+
+// Drain the ring in batches, flushing the file only once the ring is empty.
+// After stop the remaining events are still written before the thread exits
+void EventLog::run()
+{
+    vector<FleetEvent> batch(writeBatchSize);
+    unsigned long long unflushed = 0;
+    bool stopping = false;
+    while (true)
+    {
+        size_t count = 0;
+        while (count < writeBatchSize && ring.tryPop(batch[count]))
+        {
+            ++count;
+        }
+
+        if (count > 0)
+        {
+            atomic_thread_fence(memory_order_seq_cst);
+            if (waitingRecorders.load(memory_order_relaxed) > 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                }
+                spaceCondition.notify_all();
+            }
+            file.write(reinterpret_cast<const char *>(batch.data()), count * sizeof(FleetEvent));
+            unflushed += count;
+            continue;
+        }
+
+        if (unflushed > 0)
+        {
+            file.flush();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                written += unflushed;
+            }
+            writtenCondition.notify_all();
+            unflushed = 0;
+        }
+        if (stopping)
+        {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        writerSleeping.store(true, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (ring.size() == 0 && running.load())
+        {
+            writerCondition.wait(lock);
+        }
+        writerSleeping.store(false, memory_order_relaxed);
+        stopping = !running.load();
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef EVENT_LOG
+#define EVENT_LOG
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "../common/boundedQueue.h"
+using namespace std;
+
+// What happened to a server, see FleetEvent
+enum class FleetEventKind : uint8_t
+{
+    ServerOpened,
+    StatusChanged,
+    ProcessAdded,
+    ProcessRemoved,
+    ServerClosed,
+    // a process left or joined the server through consolidation
+    ProcessMigrated,
+};
+
+// One fixed-size record of the binary event log. processCount is the number
+// of processes on the server after the event, statuses follow the server
+// status numbering with -1 meaning closed
+struct FleetEvent
+{
+    int64_t timestampNs;
+    uint32_t serverId;
+    uint16_t processCount;
+    FleetEventKind kind;
+    uint8_t region;
+    uint8_t instanceType;
+    int8_t oldStatus;
+    int8_t newStatus;
+    uint8_t reserved[5];
+};
+static_assert(sizeof(FleetEvent) == 24, "FleetEvent is written to disk as is");
+
+// Written once at the start of every event log file
+struct EventLogHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+};
+
+inline constexpr char eventLogMagic[8] = {'G', 'S', 'D', 'E', 'V', 'E', 'N', 'T'};
+inline constexpr uint32_t eventLogVersion = 1;
+
+// Collects fleet events from any thread into a lock-free ring and writes them
+// to disk in batches from a background thread, so recording an event never
+// waits on the file system
+class EventLog
+{
+public:
+    // An empty path records nothing and starts no writer
+    EventLog(const string &path, size_t capacity, bool dropWhenFullInput);
+    ~EventLog();
+    void record(const FleetEvent &event);
+    // Blocks until every recorded event has been written
+    void flush();
+    unsigned long long getDroppedCount();
+
+private:
+    void run();
+    void wakeWriter();
+
+    std::ofstream file;
+    BoundedQueue<FleetEvent> ring;
+    bool enabled;
+    bool dropWhenFull;
+    atomic<bool> running;
+    atomic<unsigned long long> recorded;
+    atomic<unsigned long long> written;
+    atomic<unsigned long long> dropped;
+
+    // Threads only take the mutex to sleep: the writer when the ring is
+    // empty, recorders when it is full and flush until the writer caught up
+    std::mutex mutex;
+    atomic<bool> writerSleeping;
+    atomic<int> waitingRecorders;
+    std::condition_variable writerCondition;
+    std::condition_variable spaceCondition;
+    std::condition_variable writtenCondition;
+    thread writerThread;
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fleetSnapshot.h"
+using namespace std;
+
+//////////////////
+// Fleet snapshot writer class implementation
+FleetSnapshotWriter::FleetSnapshotWriter(const string &pathInput)
+{
+    path = pathInput;
+    stopping = false;
+}
+
+FleetSnapshotWriter::~FleetSnapshotWriter()
+{
+    stop();
+}
+
+size_t FleetSnapshotWriter::save(const function<void(FleetImage &)> &capture)
+{
+    std::lock_guard<std::mutex> lock(saveMutex);
+    capture(image);
+
+    FleetSnapshotHeader header{};
+    header.magic = fleetSnapshotMagic;
+    header.version = fleetSnapshotVersion;
+    header.shardCount = image.shards.size();
+    header.serverRecordSize = sizeof(SnapshotServer);
+    header.processRecordSize = sizeof(SnapshotProcess);
+    header.totalsSize = sizeof(ShardTotals);
+    header.region = image.region;
+    header.nextServerId = image.nextServerId;
+    header.completedDays = image.completedDays;
+    header.clockNs = image.clockNs;
+    header.wallClockNs = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    header.lastDayTotals = image.lastDayTotals;
+    for (const auto &shard : image.shards)
+    {
+        header.serverCount += shard.serverRecords.size();
+        header.processCount += shard.processes.size();
+    }
+
+    string temporaryPath = path + ".tmp";
+    {
+        ofstream file(temporaryPath, ios::binary | ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const auto &shard : image.shards)
+        {
+            file.write(reinterpret_cast<const char *>(&shard.totals), sizeof(ShardTotals));
+        }
+        for (const auto &shard : image.shards)
+        {
+            file.write(reinterpret_cast<const char *>(shard.serverRecords.data()), shard.serverRecords.size() * sizeof(SnapshotServer));
+        }
+        for (const auto &shard : image.shards)
+        {
+            file.write(reinterpret_cast<const char *>(shard.processes.data()), shard.processes.size() * sizeof(SnapshotProcess));
+        }
+        file.flush();
+        if (!file)
+        {
+            throw std::runtime_error("Cannot write fleet snapshot " + temporaryPath);
+        }
+    }
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        throw std::runtime_error("Cannot replace fleet snapshot " + path + ": " + strerror(errno));
+    }
+    return sizeof(header) + image.shards.size() * sizeof(ShardTotals) + header.serverCount * sizeof(SnapshotServer) +
+           header.processCount * sizeof(SnapshotProcess);
+}
+
+void FleetSnapshotWriter::start(double intervalSeconds, function<void(FleetImage &)> capture)
+{
+    auto interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(intervalSeconds));
+    worker = thread([this, interval, capture]()
+                    {
+                        std::unique_lock<std::mutex> lock(stopMutex);
+                        while (!stopCondition.wait_for(lock, interval, [this]()
+                                                       { return stopping; }))
+                        {
+                            lock.unlock();
+                            try
+                            {
+                                save(capture);
+                            }
+                            catch (const std::exception &error)
+                            {
+                                cerr << error.what() << endl;
+                            }
+                            lock.lock();
+                        } });
+}
+
+void FleetSnapshotWriter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopCondition.notify_all();
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+string FleetSnapshotWriter::getPath()
+{
+    return path;
+}
+
+string FleetSnapshotWriter::pathFor(const string &prefix, const string &regionName)
+{
+    return prefix + "_" + regionName + ".fleet";
+}
+
+//////////////////
+// Fleet snapshot reader class implementation
+FleetSnapshotReader::FleetSnapshotReader(const string &path)
+{
+    mapping = nullptr;
+    mappingSize = 0;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        throw std::runtime_error("Cannot open fleet snapshot: " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) == -1 || (size_t)status.st_size < sizeof(FleetSnapshotHeader))
+    {
+        close(fd);
+        throw std::runtime_error("Not a fleet snapshot: " + path);
+    }
+    mappingSize = status.st_size;
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        throw std::runtime_error("Cannot map fleet snapshot: " + path);
+    }
+
+    const FleetSnapshotHeader &saved = header();
+    size_t expectedSize = sizeof(FleetSnapshotHeader) + saved.shardCount * sizeof(ShardTotals) +
+                          saved.serverCount * sizeof(SnapshotServer) + saved.processCount * sizeof(SnapshotProcess);
+    if (saved.magic != fleetSnapshotMagic || saved.version != fleetSnapshotVersion || saved.serverRecordSize != sizeof(SnapshotServer) ||
+        saved.processRecordSize != sizeof(SnapshotProcess) || saved.totalsSize != sizeof(ShardTotals) || saved.shardCount == 0 ||
+        expectedSize != mappingSize)
+    {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        throw std::runtime_error("Not a fleet snapshot: " + path);
+    }
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+}
+
+FleetSnapshotReader::~FleetSnapshotReader()
+{
+    if (mapping != nullptr)
+    {
+        munmap(mapping, mappingSize);
+    }
+}
+
+const FleetSnapshotHeader &FleetSnapshotReader::header() const
+{
+    return *static_cast<const FleetSnapshotHeader *>(mapping);
+}
+
+const ShardTotals *FleetSnapshotReader::shardTotals() const
+{
+    return reinterpret_cast<const ShardTotals *>(static_cast<const char *>(mapping) + sizeof(FleetSnapshotHeader));
+}
+
+const SnapshotServer *FleetSnapshotReader::servers() const
+{
+    return reinterpret_cast<const SnapshotServer *>(shardTotals() + header().shardCount);
+}
+
+const SnapshotProcess *FleetSnapshotReader::processes() const
+{
+    return reinterpret_cast<const SnapshotProcess *>(servers() + header().serverCount);
+}
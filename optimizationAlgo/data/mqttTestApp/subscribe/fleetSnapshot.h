@@ -0,0 +1,162 @@
+#ifndef FLEET_SNAPSHOT
+#define FLEET_SNAPSHOT
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "shardTotals.h"
+using namespace std;
+
+// A fleet snapshot file is a FleetSnapshotHeader, the ShardTotals of every
+// shard, one SnapshotServer per server and then the SnapshotProcess records
+// of every server in the same order. Times are nanoseconds of the region's
+// clock. Like the trace files it is in host byte order and can be mapped as is
+struct FleetSnapshotHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t shardCount;
+    uint16_t serverRecordSize;
+    uint16_t processRecordSize;
+    uint16_t totalsSize;
+    uint8_t region;
+    uint8_t reserved;
+    uint32_t nextServerId;
+    uint32_t completedDays;
+    // The region's clock and the wall clock when the snapshot was written.
+    // A restore ages the saved times by the wall clock time since then
+    int64_t clockNs;
+    int64_t wallClockNs;
+    uint64_t serverCount;
+    uint64_t processCount;
+    ShardTotals lastDayTotals;
+};
+
+// Marks a server that is not replacing another one
+inline constexpr uint32_t noServerId = UINT32_MAX;
+
+struct SnapshotServer
+{
+    uint32_t id;
+    // Id of the server this one is booting to replace, noServerId if none
+    uint32_t replacesId;
+    uint16_t shard;
+    uint8_t instanceType;
+    int8_t status;
+    uint8_t booting;
+    uint8_t retiring;
+    uint16_t processCount;
+    int64_t startNs;
+    int64_t billedUntilNs;
+    int64_t readyAtNs;
+};
+static_assert(sizeof(SnapshotServer) == 40, "SnapshotServer is written to disk as is");
+
+struct SnapshotProcess
+{
+    int64_t startNs;
+    int64_t finishAtNs;
+    uint32_t executionTimeMs;
+    uint32_t vCpuMilli;
+    uint32_t memoryMb;
+    uint32_t reserved;
+};
+static_assert(sizeof(SnapshotProcess) == 32, "SnapshotProcess is written to disk as is");
+static_assert(std::is_trivially_copyable<ShardTotals>::value && sizeof(ShardTotals) % 8 == 0, "ShardTotals is written to disk as is");
+static_assert(sizeof(FleetSnapshotHeader) % 8 == 0, "The header keeps the records 8 byte aligned");
+
+inline constexpr uint32_t fleetSnapshotMagic = 0x46545347; // "GSTF"
+inline constexpr uint16_t fleetSnapshotVersion = 2;
+
+// A server as the last capture saw it, with the processes running on it
+struct CapturedServer
+{
+    SnapshotServer record;
+    // Position in its status bucket, the server moved there last comes first
+    uint64_t moveOrder = 0;
+    vector<SnapshotProcess> processes;
+};
+
+// What was captured of one shard. It is kept between snapshots and every
+// capture only applies the servers that changed since the one before
+struct ShardImage
+{
+    ShardTotals totals;
+    unordered_map<uint32_t, CapturedServer> servers;
+    // The servers in bucket order and their processes as they go into the
+    // file, rebuilt whenever a capture changed the shard
+    vector<SnapshotServer> serverRecords;
+    vector<SnapshotProcess> processes;
+};
+
+// Everything a region hands to the snapshot writer
+struct FleetImage
+{
+    uint8_t region = 0;
+    uint32_t nextServerId = 0;
+    uint32_t completedDays = 0;
+    ShardTotals lastDayTotals;
+    int64_t clockNs = 0;
+    vector<ShardImage> shards;
+    // Servers the last capture copied or dropped, the rest were unchanged
+    size_t changedServers = 0;
+};
+
+// Saves a region's fleet to one file, on demand or periodically from a thread
+// of its own. The region fills the image one shard lock at a time, the file is
+// written after every lock is released to a temporary file that replaces the
+// previous snapshot, so a crash while writing leaves the last whole snapshot behind
+class FleetSnapshotWriter
+{
+public:
+    FleetSnapshotWriter(const string &pathInput);
+    ~FleetSnapshotWriter();
+    // Returns the bytes written, throws std::runtime_error if the file cannot be written
+    size_t save(const function<void(FleetImage &)> &capture);
+    // Saves every interval until stop, errors are reported and the next interval tries again
+    void start(double intervalSeconds, function<void(FleetImage &)> capture);
+    void stop();
+    string getPath();
+
+    // <prefix>_<region>.fleet
+    static string pathFor(const string &prefix, const string &regionName);
+
+private:
+    string path;
+    // One save at a time, the image is reused by the next one
+    std::mutex saveMutex;
+    FleetImage image;
+
+    thread worker;
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    bool stopping;
+};
+
+// Read-only view of a fleet snapshot mapped into memory
+class FleetSnapshotReader
+{
+public:
+    // Throws std::runtime_error if the file cannot be mapped or is not a
+    // whole snapshot of this build's format
+    explicit FleetSnapshotReader(const string &path);
+    ~FleetSnapshotReader();
+    FleetSnapshotReader(const FleetSnapshotReader &) = delete;
+    FleetSnapshotReader &operator=(const FleetSnapshotReader &) = delete;
+    const FleetSnapshotHeader &header() const;
+    const ShardTotals *shardTotals() const;
+    const SnapshotServer *servers() const;
+    const SnapshotProcess *processes() const;
+
+private:
+    void *mapping;
+    size_t mappingSize;
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <stdexcept>
+#include "fleetView.h"
+using namespace std;
+
+// A slot holds its server in one word, so a reader never sees half of one:
+// bits 0-31 the id, 32-47 the process count, 48-51 the instance type,
+// 52-54 the status, 55 booting, 56 retiring and 63 set while the slot is used
+static constexpr uint64_t liveBit = 1ull << 63;
+
+static uint64_t packServer(const ServerView &server)
+{
+    uint64_t processCount = std::min(std::max(server.processCount, 0), 0xFFFF);
+    return (uint64_t)server.id | processCount << 32 | (uint64_t)Constants::toIndex(server.instanceType) << 48 |
+           (uint64_t)(server.status & 0x7) << 52 | (uint64_t)server.booting << 55 | (uint64_t)server.retiring << 56 | liveBit;
+}
+
+static ServerView unpackServer(uint64_t word)
+{
+    ServerView server;
+    server.id = (uint32_t)word;
+    server.processCount = (word >> 32) & 0xFFFF;
+    server.instanceType = static_cast<Constants::InstanceType>((word >> 48) & 0xF);
+    server.status = (word >> 52) & 0x7;
+    server.booting = (word >> 55) & 1;
+    server.retiring = (word >> 56) & 1;
+    return server;
+}
+
+//////////////////
+// Shard view class implementation
+ShardView::ShardView()
+{
+    sequence = 0;
+    for (auto &figure : figures)
+    {
+        figure = 0;
+    }
+    slotCount = 0;
+}
+
+std::atomic<uint64_t> &ShardView::slotWord(uint32_t slot) const
+{
+    return segments[slot / segmentSlots][slot % segmentSlots];
+}
+
+// A single writer, so the counter is bumped with plain stores. The fence keeps
+// the figures written after it from being seen before the odd count
+void ShardView::beginWrite()
+{
+    sequence.store(sequence.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    std::atomic_thread_fence(memory_order_release);
+}
+
+void ShardView::endWrite()
+{
+    sequence.store(sequence.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+// Adds (sign 1) or takes back (sign -1) what a slot word counts for
+void ShardView::account(uint64_t word, int usedVcpuMilli, int usedMemoryMb, int sign)
+{
+    if (!(word & liveBit))
+    {
+        return;
+    }
+    ServerView server = unpackServer(word);
+    int type = Constants::toIndex(server.instanceType);
+    auto bump = [&](int figure, int64_t amount)
+    {
+        figures[figure].store(figures[figure].load(memory_order_relaxed) + sign * amount, memory_order_relaxed);
+    };
+    bump(FirstStatus + std::min(server.status, reportStatusCount - 1), 1);
+    bump(Booting, server.booting);
+    bump(Retiring, server.retiring);
+    bump(FirstTypeServers + type, 1);
+    bump(FirstTypeProcesses + type, server.processCount);
+    bump(FirstTypeVcpu + type, usedVcpuMilli);
+    bump(FirstTypeMemory + type, usedMemoryMb);
+}
+
+void ShardView::publish(int &slot, const ServerView &server, int usedVcpuMilli, int usedMemoryMb)
+{
+    uint64_t word = packServer(server);
+    if (slot != -1 && slotWord(slot).load(memory_order_relaxed) == word && slotVcpuMilli[slot] == usedVcpuMilli && slotMemoryMb[slot] == usedMemoryMb)
+    {
+        return;
+    }
+
+    beginWrite();
+    if (slot == -1)
+    {
+        if (!freeSlots.empty())
+        {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            uint32_t next = slotCount.load(memory_order_relaxed);
+            if (next % segmentSlots == 0)
+            {
+                if (next / segmentSlots == maxSegments)
+                {
+                    endWrite();
+                    throw std::runtime_error("The fleet view of a shard is full");
+                }
+                segments[next / segmentSlots] = std::make_unique<std::atomic<uint64_t>[]>(segmentSlots);
+                for (uint32_t i = 0; i < segmentSlots; ++i)
+                {
+                    segments[next / segmentSlots][i].store(0, memory_order_relaxed);
+                }
+            }
+            slot = next;
+            slotVcpuMilli.push_back(0);
+            slotMemoryMb.push_back(0);
+            // Published after the segment, a reader that sees the count sees the segment
+            slotCount.store(next + 1, memory_order_release);
+        }
+    }
+    account(slotWord(slot).load(memory_order_relaxed), slotVcpuMilli[slot], slotMemoryMb[slot], -1);
+    account(word, usedVcpuMilli, usedMemoryMb, 1);
+    slotWord(slot).store(word, memory_order_relaxed);
+    slotVcpuMilli[slot] = usedVcpuMilli;
+    slotMemoryMb[slot] = usedMemoryMb;
+    endWrite();
+}
+
+void ShardView::remove(int &slot)
+{
+    if (slot == -1)
+    {
+        return;
+    }
+    beginWrite();
+    account(slotWord(slot).load(memory_order_relaxed), slotVcpuMilli[slot], slotMemoryMb[slot], -1);
+    slotWord(slot).store(0, memory_order_relaxed);
+    endWrite();
+    freeSlots.push_back(slot);
+    slot = -1;
+}
+
+bool ShardView::read(FleetViewImage &image, bool withServers) const
+{
+    int64_t copied[FigureCount];
+    size_t firstServer = image.servers.size();
+    auto copy = [&]()
+    {
+        for (int figure = 0; figure < FigureCount; ++figure)
+        {
+            copied[figure] = figures[figure].load(memory_order_relaxed);
+        }
+        image.servers.resize(firstServer);
+        if (withServers)
+        {
+            uint32_t slots = slotCount.load(memory_order_acquire);
+            for (uint32_t slot = 0; slot < slots; ++slot)
+            {
+                uint64_t word = slotWord(slot).load(memory_order_relaxed);
+                if (word & liveBit)
+                {
+                    image.servers.push_back(unpackServer(word));
+                }
+            }
+        }
+    };
+
+    bool consistent = false;
+    for (int attempt = 0; attempt < maxReadAttempts && !consistent; ++attempt)
+    {
+        uint64_t before = sequence.load(memory_order_acquire);
+        if (before % 2 == 1)
+        {
+            continue;
+        }
+        copy();
+        // Keeps the loads of the copy from moving past the second look at the counter
+        std::atomic_thread_fence(memory_order_acquire);
+        consistent = sequence.load(memory_order_relaxed) == before;
+    }
+    if (!consistent)
+    {
+        // Every attempt overlapped a change, settle for figures and servers
+        // that are each whole but not necessarily from the same moment
+        copy();
+        ++image.inconsistentShards;
+    }
+
+    for (int status = 0; status < reportStatusCount; ++status)
+    {
+        image.serversPerStatus[status] += copied[FirstStatus + status];
+    }
+    image.bootingServers += copied[Booting];
+    image.retiringServers += copied[Retiring];
+    for (int type = 0; type < Constants::instanceTypeCount; ++type)
+    {
+        image.serversPerType[type] += copied[FirstTypeServers + type];
+        image.processesPerType[type] += copied[FirstTypeProcesses + type];
+        image.usedVcpuMilliPerType[type] += copied[FirstTypeVcpu + type];
+        image.usedMemoryMbPerType[type] += copied[FirstTypeMemory + type];
+    }
+    return consistent;
+}
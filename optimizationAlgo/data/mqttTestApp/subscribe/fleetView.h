@@ -0,0 +1,97 @@
+#ifndef FLEET_VIEW
+#define FLEET_VIEW
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "appConst.h"
+#include "reportFormat.h"
+using namespace std;
+
+// One server as the fleet view shows it
+struct ServerView
+{
+    uint32_t id;
+    Constants::InstanceType instanceType;
+    // 0 to 3, closed servers leave the view
+    int status;
+    bool booting;
+    bool retiring;
+    int processCount;
+};
+
+// Figures of the fleet read from the views of one or more shards
+struct FleetViewImage
+{
+    int serversPerStatus[reportStatusCount] = {};
+    int bootingServers = 0;
+    int retiringServers = 0;
+    // Load of each instance type
+    int serversPerType[Constants::instanceTypeCount] = {};
+    int processesPerType[Constants::instanceTypeCount] = {};
+    int64_t usedVcpuMilliPerType[Constants::instanceTypeCount] = {};
+    int64_t usedMemoryMbPerType[Constants::instanceTypeCount] = {};
+    // Only filled when asked for, in no particular order
+    vector<ServerView> servers;
+    // Shards that changed during every attempt to read them. Each of their
+    // figures and servers is whole, but they may be a few changes apart
+    int inconsistentShards = 0;
+};
+
+// Read-only copy of one shard's servers for reports and monitoring. The
+// thread holding the shard mutex publishes every change of a server and any
+// thread reads the view without taking a lock: the sequence counter is odd
+// while a change is written and a reader that saw it move reads again
+class alignas(64) ShardView
+{
+public:
+    ShardView();
+    ShardView(const ShardView &) = delete;
+    ShardView &operator=(const ShardView &) = delete;
+    // Publishes the current state of a server, the caller holds the shard
+    // mutex. slot is the server's place in the view, -1 before its first publish
+    void publish(int &slot, const ServerView &server, int usedVcpuMilli, int usedMemoryMb);
+    // Takes the server out of the view and sets its slot back to -1
+    void remove(int &slot);
+    // Adds the shard's figures to the image, and its servers if withServers.
+    // Returns false if the shard changed during every attempt
+    bool read(FleetViewImage &image, bool withServers) const;
+
+    // Slots are allocated in segments that never move, so readers can follow
+    // them while the view grows
+    static constexpr uint32_t segmentSlots = 4096;
+    static constexpr uint32_t maxSegments = 1024;
+    static constexpr int maxReadAttempts = 16;
+
+private:
+    enum Figure : int
+    {
+        FirstStatus = 0,
+        Booting = FirstStatus + reportStatusCount,
+        Retiring,
+        FirstTypeServers,
+        FirstTypeProcesses = FirstTypeServers + Constants::instanceTypeCount,
+        FirstTypeVcpu = FirstTypeProcesses + Constants::instanceTypeCount,
+        FirstTypeMemory = FirstTypeVcpu + Constants::instanceTypeCount,
+        FigureCount = FirstTypeMemory + Constants::instanceTypeCount
+    };
+
+    std::atomic<uint64_t> &slotWord(uint32_t slot) const;
+    void beginWrite();
+    void endWrite();
+    void account(uint64_t word, int usedVcpuMilli, int usedMemoryMb, int sign);
+
+    std::atomic<uint64_t> sequence;
+    std::atomic<int64_t> figures[FigureCount];
+    // Slots handed out so far, every one of them has its segment
+    std::atomic<uint32_t> slotCount;
+    // One packed word per slot, 0 for a free slot
+    unique_ptr<std::atomic<uint64_t>[]> segments[maxSegments];
+
+    // Only used by the thread holding the shard mutex
+    vector<uint32_t> freeSlots;
+    vector<int> slotVcpuMilli;
+    vector<int> slotMemoryMb;
+};
+
+#endif
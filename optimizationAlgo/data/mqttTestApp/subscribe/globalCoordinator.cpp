@@ -0,0 +1,116 @@
+#include "globalCoordinator.h"
+#include "messageReceiver.h"
+using namespace std;
+
+//////////////////
+// Global coordinator class implementation
+GlobalCoordinator::GlobalCoordinator(float maxSpillLatencyMsInput)
+{
+    maxSpillLatencyMs = maxSpillLatencyMsInput;
+}
+
+int GlobalCoordinator::registerRegion(RegionalAlgo *region)
+{
+    size_t previousCount = slots.size();
+    slots.push_back(make_unique<SnapshotSlot>());
+    slots.back()->region = region;
+
+    // Grow the penalty matrix by one row and column
+    vector<float> grown((previousCount + 1) * (previousCount + 1), 0);
+    for (size_t from = 0; from < previousCount; ++from)
+    {
+        for (size_t to = 0; to < previousCount; ++to)
+        {
+            grown[from * (previousCount + 1) + to] = latencyPenaltyMs[from * previousCount + to];
+        }
+    }
+    latencyPenaltyMs = std::move(grown);
+    for (size_t other = 0; other < previousCount; ++other)
+    {
+        float latency = Constants::interRegionLatencyMs[Constants::toIndex(region->region)][Constants::toIndex(slots[other]->region->region)];
+        setLatencyPenalty(previousCount, other, latency);
+        setLatencyPenalty(other, previousCount, latency);
+    }
+    return previousCount;
+}
+
+void GlobalCoordinator::setLatencyPenalty(int fromRegion, int toRegion, float latencyMs)
+{
+    latencyPenaltyMs[fromRegion * slots.size() + toRegion] = latencyMs;
+}
+
+float GlobalCoordinator::getLatencyPenalty(int fromRegion, int toRegion) const
+{
+    return latencyPenaltyMs[fromRegion * slots.size() + toRegion];
+}
+
+// An odd sequence marks a write in progress. The fences keep the field stores
+// between the two sequence increments as seen from the readers
+void GlobalCoordinator::publish(int regionIndex, const RegionSnapshot &snapshot)
+{
+    SnapshotSlot &slot = *slots[regionIndex];
+    uint64_t sequence = slot.sequence.load(memory_order_relaxed);
+    slot.sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot.freeSlots.store(snapshot.freeSlots, memory_order_relaxed);
+    slot.serverCount.store(snapshot.serverCount, memory_order_relaxed);
+    slot.runningProcesses.store(snapshot.runningProcesses, memory_order_relaxed);
+    slot.sequence.store(sequence + 2, memory_order_release);
+}
+
+RegionSnapshot GlobalCoordinator::read(int regionIndex) const
+{
+    const SnapshotSlot &slot = *slots[regionIndex];
+    RegionSnapshot snapshot;
+    uint64_t before;
+    uint64_t after;
+    do
+    {
+        before = slot.sequence.load(memory_order_acquire);
+        snapshot.freeSlots = slot.freeSlots.load(memory_order_relaxed);
+        snapshot.serverCount = slot.serverCount.load(memory_order_relaxed);
+        snapshot.runningProcesses = slot.runningProcesses.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        after = slot.sequence.load(memory_order_relaxed);
+    } while (before != after || (before & 1));
+    snapshot.version = before / 2;
+    return snapshot;
+}
+
+// One pass over the regions, reading only their published snapshots
+RegionalAlgo *GlobalCoordinator::findSpillTarget(int fromRegion, float &latencyMs) const
+{
+    RegionalAlgo *target = nullptr;
+    int targetFreeSlots = 0;
+    float scaleUpPrice = Constants::priceOf(slots[fromRegion]->region->region, Constants::InstanceType::c08);
+    for (size_t other = 0; other < slots.size(); ++other)
+    {
+        if ((int)other == fromRegion)
+        {
+            continue;
+        }
+        float penalty = getLatencyPenalty(fromRegion, other);
+        if (penalty > maxSpillLatencyMs || Constants::priceOf(slots[other]->region->region, Constants::InstanceType::c08) > scaleUpPrice)
+        {
+            continue;
+        }
+        int freeSlots = read(other).freeSlots;
+        if (freeSlots <= 0)
+        {
+            continue;
+        }
+        // Lowest penalty first, then the region with the most room
+        if (target == nullptr || penalty < latencyMs || (penalty == latencyMs && freeSlots > targetFreeSlots))
+        {
+            target = slots[other]->region;
+            latencyMs = penalty;
+            targetFreeSlots = freeSlots;
+        }
+    }
+    return target;
+}
+
+size_t GlobalCoordinator::regionCount() const
+{
+    return slots.size();
+}
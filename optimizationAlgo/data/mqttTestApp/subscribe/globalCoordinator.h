@@ -0,0 +1,71 @@
+#ifndef GLOBAL_COORDINATOR
+#define GLOBAL_COORDINATOR
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "../common/requestMessage.h"
+using namespace std;
+
+class RegionalAlgo;
+
+// Free capacity of a region as last published by the region itself
+struct RegionSnapshot
+{
+    // Process slots left below the max threshold of booted status 0 and 1
+    // servers, taking a request there does not make the region scale up
+    int freeSlots;
+    int serverCount;
+    int runningProcesses;
+    // Publication counter of the region, increases with every snapshot
+    uint64_t version;
+};
+
+// Sees the free capacity of every region and lets a region that would have to
+// scale up hand the request to another region instead, as long as the latency
+// penalty between the two stays acceptable.
+// Each region publishes its snapshot into its own slot with a sequence lock:
+// the region is the only writer, readers retry if they raced with it, so
+// neither side ever blocks and the placement path takes no global lock.
+// Regions are registered before any traffic flows and are never removed
+class GlobalCoordinator
+{
+public:
+    explicit GlobalCoordinator(float maxSpillLatencyMsInput = 200);
+    GlobalCoordinator(const GlobalCoordinator &) = delete;
+    GlobalCoordinator &operator=(const GlobalCoordinator &) = delete;
+
+    // Returns the index of the region in the coordinator. The latency
+    // penalty to every already registered region defaults to the typical
+    // inter-region latency of Constants
+    int registerRegion(RegionalAlgo *region);
+    void setLatencyPenalty(int fromRegion, int toRegion, float latencyMs);
+    float getLatencyPenalty(int fromRegion, int toRegion) const;
+    // Called by the region that owns the slot, with its servers locked
+    void publish(int regionIndex, const RegionSnapshot &snapshot);
+    RegionSnapshot read(int regionIndex) const;
+    // Region with free capacity, no higher price for the server a scale-up
+    // would launch and the lowest latency penalty from the given region, or
+    // nullptr if no region qualifies within the latency limit
+    RegionalAlgo *findSpillTarget(int fromRegion, float &latencyMs) const;
+    size_t regionCount() const;
+
+private:
+    // Written by one region only, aligned so neighbouring regions do not
+    // invalidate each other's cache line
+    struct alignas(64) SnapshotSlot
+    {
+        atomic<uint64_t> sequence{0};
+        atomic<int> freeSlots{0};
+        atomic<int> serverCount{0};
+        atomic<int> runningProcesses{0};
+        RegionalAlgo *region = nullptr;
+    };
+
+    float maxSpillLatencyMs;
+    vector<unique_ptr<SnapshotSlot>> slots;
+    // Latency penalties indexed by [from * regionCount + to]
+    vector<float> latencyPenaltyMs;
+};
+
+#endif
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include "lowerBoundSolver.h"
+#include "../common/trafficProfile.h"
+#include "../common/workStealingPool.h"
+using namespace std;
+
+// Slices solved by one task of the pool
+static constexpr size_t slicesPerTask = 4096;
+
+// A running process, ordered by the millisecond it completes
+struct RunningDemand
+{
+    int64_t finishMs;
+    int64_t vCpuMilli;
+    int64_t memoryMb;
+    bool operator>(const RunningDemand &other) const
+    {
+        return finishMs > other.finishMs;
+    }
+};
+
+//////////////////
+// Lower bound solver class implementation
+LowerBoundSolver::LowerBoundSolver(const LowerBoundOptions &optionsInput)
+{
+    options = optionsInput;
+    if (options.threads <= 0)
+    {
+        options.threads = std::max(1u, thread::hardware_concurrency());
+    }
+    for (int i = 0; i < Constants::instanceTypeCount; ++i)
+    {
+        Constants::InstanceType instanceType = static_cast<Constants::InstanceType>(i);
+        if (options.processCapacity[i].absoluteLimit < 1)
+        {
+            throw std::invalid_argument(string("The absolute limit of ") + Constants::instanceTypeName(instanceType) + " must be at least 1");
+        }
+        hourlyPrice[i] = Constants::priceOf(options.region, instanceType);
+        holds[i][0] = options.processCapacity[i].absoluteLimit;
+        holds[i][1] = Constants::usableVcpuMilli(instanceType);
+        holds[i][2] = Constants::usableMemoryMb(instanceType);
+        for (int dimension = 0; dimension < 3; ++dimension)
+        {
+            double unit = hourlyPrice[i] / holds[i][dimension];
+            cheapestUnit[i][dimension] = i == 0 ? unit : std::min(unit, cheapestUnit[i - 1][dimension]);
+        }
+    }
+}
+
+// Depth first over the count of each instance type, largest type first. A
+// branch is cut when even the cheapest price per unit of the types left
+// cannot cover the remaining demand for less than the best fleet so far
+void LowerBoundSolver::search(int type, double cost, int64_t remaining[3], double &best) const
+{
+    if (remaining[0] <= 0 && remaining[1] <= 0 && remaining[2] <= 0)
+    {
+        best = std::min(best, cost);
+        return;
+    }
+    double bound = cost;
+    int64_t count = 0;
+    for (int dimension = 0; dimension < 3; ++dimension)
+    {
+        if (remaining[dimension] > 0)
+        {
+            bound = std::max(bound, cost + remaining[dimension] * cheapestUnit[type][dimension]);
+            count = std::max(count, (remaining[dimension] + holds[type][dimension] - 1) / holds[type][dimension]);
+        }
+    }
+    if (bound >= best)
+    {
+        return;
+    }
+    // The smallest type alone has to cover whatever is left
+    if (type == 0)
+    {
+        best = std::min(best, cost + count * hourlyPrice[0]);
+        return;
+    }
+    for (int64_t servers = count; servers >= 0; --servers)
+    {
+        int64_t left[3];
+        for (int dimension = 0; dimension < 3; ++dimension)
+        {
+            left[dimension] = remaining[dimension] - servers * holds[type][dimension];
+        }
+        search(type - 1, cost + servers * hourlyPrice[type], left, best);
+    }
+}
+
+double LowerBoundSolver::minimumHourlyCost(int processes, int64_t vCpuMilli, int64_t memoryMb) const
+{
+    if (processes <= 0)
+    {
+        return 0;
+    }
+    int64_t remaining[3] = {processes, options.resourceConstraints ? vCpuMilli : 0, options.resourceConstraints ? memoryMb : 0};
+    double best = numeric_limits<double>::infinity();
+    search(Constants::instanceTypeCount - 1, 0, remaining, best);
+    return best;
+}
+
+vector<DemandSlice> LowerBoundSolver::buildSlices(TraceReader &trace)
+{
+    vector<DemandSlice> slices;
+    priority_queue<RunningDemand, vector<RunningDemand>, greater<RunningDemand>> running;
+    int64_t nowMs = 0;
+    int64_t sliceStartMs = 0;
+    int64_t dayStartMs = 0;
+    int day = 0;
+    int processes = 0;
+    int64_t vCpuMilli = 0;
+    int64_t memoryMb = 0;
+
+    auto closeSlice = [&](int64_t endMs)
+    {
+        if (endMs > sliceStartMs && processes > 0)
+        {
+            slices.push_back({(endMs - sliceStartMs) / 1000.0, day, processes, vCpuMilli, memoryMb});
+        }
+        sliceStartMs = endMs;
+    };
+    // Completions up to and including the time go before an arrival at that
+    // time, like the simulation dispatches its due events first
+    auto advanceTo = [&](int64_t targetMs)
+    {
+        while (!running.empty() && running.top().finishMs <= targetMs)
+        {
+            closeSlice(running.top().finishMs);
+            --processes;
+            vCpuMilli -= running.top().vCpuMilli;
+            memoryMb -= running.top().memoryMb;
+            running.pop();
+        }
+        closeSlice(targetMs);
+    };
+
+    RequestMessage request;
+    int pauseMs;
+    while (trace.next(request, pauseMs))
+    {
+        advanceTo(nowMs);
+        if (TrafficProfile::isEndOfDay((nowMs - dayStartMs) / 1000))
+        {
+            ++day;
+            dayStartMs = nowMs;
+        }
+        running.push({nowMs + request.durationMs, request.vCpuMilli, request.memoryMb});
+        ++processes;
+        vCpuMilli += request.vCpuMilli;
+        memoryMb += request.memoryMb;
+        nowMs += pauseMs;
+    }
+    // The last day ends once the pause after the last request is over,
+    // whether or not that pause finishes the day
+    advanceTo(nowMs);
+    if (slices.empty() || slices.back().day != day)
+    {
+        slices.push_back({0, day, 0, 0, 0});
+    }
+    return slices;
+}
+
+vector<double> LowerBoundSolver::solve(TraceReader &trace)
+{
+    vector<DemandSlice> slices = buildSlices(trace);
+    size_t dayCount = slices.back().day + 1;
+    vector<double> costs(dayCount, 0);
+    std::mutex costsMutex;
+    {
+        WorkStealingPool pool(options.threads);
+        for (size_t first = 0; first < slices.size(); first += slicesPerTask)
+        {
+            size_t last = std::min(slices.size(), first + slicesPerTask);
+            pool.submit([this, &slices, &costs, &costsMutex, first, last, dayCount]()
+                        {
+                            // Count-only demand repeats a lot, so each task
+                            // remembers the fleets it already priced
+                            unordered_map<int, double> countOnly;
+                            vector<double> partial(dayCount, 0);
+                            for (size_t i = first; i < last; ++i)
+                            {
+                                const DemandSlice &slice = slices[i];
+                                double hourly;
+                                if (options.resourceConstraints)
+                                {
+                                    hourly = minimumHourlyCost(slice.processes, slice.vCpuMilli, slice.memoryMb);
+                                }
+                                else
+                                {
+                                    auto cached = countOnly.find(slice.processes);
+                                    if (cached == countOnly.end())
+                                    {
+                                        cached = countOnly.emplace(slice.processes, minimumHourlyCost(slice.processes, 0, 0)).first;
+                                    }
+                                    hourly = cached->second;
+                                }
+                                // Simulated seconds stand for timeCompressionFactor real ones, like in calculateServerCost
+                                partial[slice.day] += hourly * slice.seconds * Constants::timeCompressionFactor / 3600;
+                            }
+                            std::lock_guard<std::mutex> lock(costsMutex);
+                            for (size_t day = 0; day < dayCount; ++day)
+                            {
+                                costs[day] += partial[day];
+                            } });
+        }
+        pool.waitIdle();
+    }
+    return costs;
+}
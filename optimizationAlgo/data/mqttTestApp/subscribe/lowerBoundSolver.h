@@ -0,0 +1,71 @@
+#ifndef LOWER_BOUND_SOLVER
+#define LOWER_BOUND_SOLVER
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../common/requestTrace.h"
+#include "appConst.h"
+#include "regionConfig.h"
+using namespace std;
+
+// Processes that run during one stretch of a trace's timeline in which
+// nothing arrives or completes
+struct DemandSlice
+{
+    double seconds;
+    int day;
+    int processes;
+    int64_t vCpuMilli;
+    int64_t memoryMb;
+};
+
+struct LowerBoundOptions
+{
+    Constants::Region region = Constants::Region::Oregon;
+    // A server never holds more than absoluteLimit processes
+    std::array<Constants::Capacity, Constants::instanceTypeCount> processCapacity = defaultProcessCapacity();
+    // Also cover the vCPU and memory of the running processes. Only the
+    // placement policies that check a request's demand respect these, so
+    // the bound must not use them for status-order
+    bool resourceConstraints = false;
+    // Threads solving slices, all cores when 0
+    int threads = 0;
+};
+
+// Offline lower bound on the server cost of each day of a recorded trace.
+// Every process occupies a server at least from its arrival until its
+// duration is over, whatever the online algorithm does. At every moment the
+// fleet has to hold the processes running then, so it costs at least the
+// cheapest mix of instance types that can hold them, found by branch and
+// bound over the instance type counts. The bound integrates that cost over
+// the timeline, solving the slices in parallel. It is a relaxation: the
+// cheapest mix may change from one slice to the next as if processes moved
+// between servers for free and servers booted instantly.
+// The online cost bills whole seconds per server, so on days with very
+// many short-lived servers it can fall a fraction of a percent below it
+class LowerBoundSolver
+{
+public:
+    LowerBoundSolver(const LowerBoundOptions &optionsInput);
+    // Bound of each day of the trace in USD. Days end like in the
+    // discrete-event simulation: at the first arrival after TrafficProfile::dayEnd
+    // seconds of the day, and the last one when the trace runs out
+    vector<double> solve(TraceReader &trace);
+    // Cheapest fleet that holds the demand, in USD per hour
+    double minimumHourlyCost(int processes, int64_t vCpuMilli, int64_t memoryMb) const;
+    // The timeline of the trace cut at every arrival, completion and day end
+    static vector<DemandSlice> buildSlices(TraceReader &trace);
+
+private:
+    void search(int type, double cost, int64_t remaining[3], double &best) const;
+
+    LowerBoundOptions options;
+    double hourlyPrice[Constants::instanceTypeCount];
+    // What each instance type holds: processes, vCPU and memory
+    int64_t holds[Constants::instanceTypeCount][3];
+    // Lowest price per unit of each dimension among the types up to the index
+    double cheapestUnit[Constants::instanceTypeCount][3];
+};
+
+#endif
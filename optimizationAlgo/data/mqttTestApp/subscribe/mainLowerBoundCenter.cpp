@@ -0,0 +1,78 @@
+#include <iostream> // std::cout.
+#include <string>
+#include <vector>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include "lowerBoundSolver.h"
+using namespace std;
+
+// Prints the offline lower bound on the server cost of every day of a
+// recorded trace, e.g. one written by simulateDays --record=prefix.
+// Usage: solveLowerBound trace [--region=Oregon|London|Singapore] [--policy=status-order|...] [--threads=N]
+// Placement policies other than status-order also respect the vCPU and
+// memory of the servers, so the bound covers those as well for them
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: solveLowerBound trace [--region=name] [--policy=name] [--threads=N]" << endl;
+        return 1;
+    }
+    string tracePath = argv[1];
+    LowerBoundOptions options;
+    for (int i = 2; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (option.rfind("--region=", 0) == 0)
+        {
+            auto region = Constants::parseRegion(option.substr(9));
+            if (!region)
+            {
+                cerr << "Unknown region: " << option.substr(9) << endl;
+                return 1;
+            }
+            options.region = *region;
+        }
+        else if (option.rfind("--policy=", 0) == 0)
+        {
+            auto policy = parsePlacementPolicy(option.substr(9));
+            if (!policy)
+            {
+                cerr << "Unknown placement policy: " << option.substr(9) << endl;
+                return 1;
+            }
+            options.resourceConstraints = *policy != PlacementPolicy::StatusOrder;
+        }
+        else if (option.rfind("--threads=", 0) == 0)
+        {
+            options.threads = std::max(1, stoi(option.substr(10)));
+        }
+        else
+        {
+            cerr << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        TraceReader trace(tracePath);
+        auto start = chrono::steady_clock::now();
+        vector<double> costs = LowerBoundSolver(options).solve(trace);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        for (size_t day = 0; day < costs.size(); ++day)
+        {
+            cout << "Day " << day + 1 << ": " << costs[day] << "$" << endl;
+        }
+        cout << "Total: " << std::accumulate(costs.begin(), costs.end(), 0.0) << "$ over " << costs.size() << " days of "
+             << trace.size() << " requests, solved in " << seconds << " seconds" << endl;
+    }
+    catch (const std::exception &error)
+    {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
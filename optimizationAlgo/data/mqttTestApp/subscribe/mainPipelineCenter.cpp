@@ -0,0 +1,131 @@
+#include <iostream> // std::cout.
+#include <string>   // std::stoi.
+#include <vector>   // vectors.
+#include <thread>   // threads.
+#include <algorithm>
+#include "messageReceiver.h"
+#include "../common/inProcessTransport.h"
+#include "../common/requestSource.h"
+using namespace std;
+
+// Publishes a fixed number of generated requests to every region through the
+// in-memory transport as fast as the regions take them, ends the day and
+// quits, then checks that every request was received and placed. Runs the
+// whole receive and placement pipeline without a broker or the MQTT libraries.
+// Usage: runPipeline [requests] [seed] [--shards=N] [--global] [--batch=N] [--queue=N]
+// --batch packs that many requests into one message, --queue is the depth of
+// each topic's queue, small depths make the publishers wait for the receivers
+int main(int argc, char *argv[])
+{
+    int requestCount = argc > 1 ? stoi(argv[1]) : 1000;
+    unsigned int seed = argc > 2 ? stoul(argv[2]) : 1;
+    bool global = false;
+    int batchSize = 1;
+    size_t queueDepth = 64;
+    RegionConfig config;
+    config.writeLogFiles = false;
+    for (int i = 3; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (option.rfind("--shards=", 0) == 0)
+        {
+            config.shardCount = std::max(1, stoi(option.substr(9)));
+            config.placementThreads = std::max(config.placementThreads, config.shardCount);
+        }
+        else if (option == "--global")
+        {
+            global = true;
+        }
+        else if (option.rfind("--batch=", 0) == 0)
+        {
+            batchSize = std::max(1, stoi(option.substr(8)));
+        }
+        else if (option.rfind("--queue=", 0) == 0)
+        {
+            queueDepth = std::max(1, stoi(option.substr(8)));
+        }
+        else
+        {
+            cerr << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+
+    // Created before the regions so they outlive them
+    GlobalCoordinator coordinator;
+    InProcessTransport transport(queueDepth);
+    vector<unique_ptr<RegionalAlgo>> regions;
+    try
+    {
+        regions.push_back(make_unique<RegionalAlgo>("Oregon", config));
+        regions.push_back(make_unique<RegionalAlgo>("London", config));
+        regions.push_back(make_unique<RegionalAlgo>("Singapore", config));
+    }
+    catch (const std::exception &error)
+    {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    if (global)
+    {
+        for (auto &region : regions)
+        {
+            region->attachCoordinator(&coordinator);
+        }
+    }
+
+    vector<thread> threads;
+    for (auto &region : regions)
+    {
+        threads.emplace_back([&region, &transport]()
+                             { region->messageReceiver(transport); });
+    }
+    // The pauses of the traffic profile are skipped, only the requests are drawn
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        threads.emplace_back([&transport, &regions, i, seed, requestCount, batchSize]()
+                             {
+                                 const string &regionName = regions[i]->regionName;
+                                 RequestSource requestSource(regionName, seed + i, ArrivalOptions());
+                                 auto publisher = transport.createPublisher("publish_" + regionName, regionName);
+                                 vector<RequestMessage> batch;
+                                 for (int sent = 0; sent < requestCount; ++sent)
+                                 {
+                                     RequestMessage request;
+                                     int pauseMs;
+                                     requestSource.next(0, request, pauseMs);
+                                     batch.push_back(request);
+                                     if ((int)batch.size() == batchSize || sent + 1 == requestCount)
+                                     {
+                                         publisher->publish(batch.data(), batch.size() * sizeof(RequestMessage));
+                                         batch.clear();
+                                     }
+                                 }
+                                 publisher->publish("END OF DAY");
+                                 publisher->publish("quit");
+                             });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    // A spilled request is placed by another region, maybe after that
+    // region's day ended, so the check is on the counters and not the day totals
+    bool complete = true;
+    uint64_t placed = 0;
+    for (auto &region : regions)
+    {
+        MetricsSnapshot metrics = region->getMetrics();
+        uint64_t received = metrics.counters[(int)MetricCounter::RequestsReceived];
+        cout << "Pipeline: " << region->regionName << " received " << received << " requests, placed "
+             << metrics.counters[(int)MetricCounter::RequestsPlaced] << ", spilled "
+             << metrics.counters[(int)MetricCounter::RequestsSpilledOut] << ", took over "
+             << metrics.counters[(int)MetricCounter::RequestsSpilledIn] << endl;
+        complete = complete && received == (uint64_t)requestCount;
+        placed += metrics.counters[(int)MetricCounter::RequestsPlaced];
+    }
+    uint64_t expected = (uint64_t)requestCount * regions.size();
+    cout << "Pipeline: " << placed << " of " << expected << " requests placed" << endl;
+    return complete && placed == expected ? 0 : 1;
+}
@@ -1,25 +1,147 @@
-#include <ostream>  // std::cout.
+#include <iostream> // std::cout.
+#include <algorithm>
 #include <vector>  // vectors.
 #include <thread>  // threads.
+#include <string>
+#include <random>
 #include "messageReceiver.h"
+#include "../common/inProcessTransport.h"
+#include "../common/mqttTransport.h"
+#include "../publish/requestGenerator.h"
 using namespace std;
 
-
-int main()
+// Usage: simpleConsumer [--global] [--shards=N] [--in-process]
+//                       [--metrics=prefix|unix:path] [--metrics-interval=seconds]
+//                       [--snapshot=prefix] [--snapshot-interval=seconds] [--restore]
+//                       [--report-interval=seconds] [--max-servers=N] [--budget=USD/hour]
+//                       [--admission-queue=N]
+// --global lets a region hand requests to another region with free capacity
+// instead of scaling up, --shards splits each region's fleet into N shards
+// placed by as many threads. --in-process runs the request generator in this
+// process and hands its requests over in memory, so no broker is needed.
+// --metrics exports each region's counters and latency histograms every
+// interval, one JSON line at a time. --snapshot saves each region's fleet to
+// <prefix>_<region>.fleet every interval and on quit, --restore starts from
+// those files after a restart instead of an empty fleet. --report-interval
+// prints the load of every server of each region that often. --max-servers
+// and --budget cap each region's fleet, requests that find no room wait in
+// an admission queue and the request generator is asked to hold back while it fills
+int main(int argc, char *argv[])
 {
+    bool global = false;
+    bool inProcess = false;
+    RegionConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (option == "--global")
+        {
+            global = true;
+        }
+        else if (option.rfind("--shards=", 0) == 0)
+        {
+            config.shardCount = std::max(1, stoi(option.substr(9)));
+            config.placementThreads = std::max(config.placementThreads, config.shardCount);
+        }
+        else if (option == "--in-process")
+        {
+            inProcess = true;
+        }
+        else if (option.rfind("--metrics=", 0) == 0)
+        {
+            config.metricsTarget = option.substr(10);
+        }
+        else if (option.rfind("--metrics-interval=", 0) == 0)
+        {
+            config.metricsIntervalSeconds = std::max(0.1, stod(option.substr(19)));
+        }
+        else if (option.rfind("--snapshot=", 0) == 0)
+        {
+            config.snapshotPrefix = option.substr(11);
+        }
+        else if (option.rfind("--snapshot-interval=", 0) == 0)
+        {
+            config.snapshotIntervalSeconds = std::max(0.1, stod(option.substr(20)));
+        }
+        else if (option == "--restore")
+        {
+            config.restoreSnapshot = true;
+        }
+        else if (option.rfind("--report-interval=", 0) == 0)
+        {
+            config.reportIntervalSeconds = std::max(0.0, stod(option.substr(18)));
+        }
+        else if (option.rfind("--max-servers=", 0) == 0)
+        {
+            config.maxServers = std::max(0, stoi(option.substr(14)));
+        }
+        else if (option.rfind("--budget=", 0) == 0)
+        {
+            config.maxCostPerHour = std::max(0.0, stod(option.substr(9)));
+        }
+        else if (option.rfind("--admission-queue=", 0) == 0)
+        {
+            config.admissionQueueDepth = std::max(0, stoi(option.substr(18)));
+        }
+        else
+        {
+            cerr << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+    if (config.restoreSnapshot && config.snapshotPrefix.empty())
+    {
+        cerr << "--restore needs --snapshot=prefix" << endl;
+        return 1;
+    }
+    // Created before the regions so they outlive them
+    GlobalCoordinator coordinator;
+    unique_ptr<Transport> transport;
+    if (inProcess)
+    {
+        transport = make_unique<InProcessTransport>();
+    }
+    else
+    {
+        transport = make_unique<MqttTransport>();
+    }
+
     // Create a vector to store the algorithms for scaling
     vector<unique_ptr<RegionalAlgo>> regions;
     // Create a vector to store the threads
     vector<thread> threads;
 
-    regions.push_back(make_unique<RegionalAlgo>("Oregon"));
-    regions.push_back(make_unique<RegionalAlgo>("London"));
-    regions.push_back(make_unique<RegionalAlgo>("Singapore"));
+    try
+    {
+        regions.push_back(make_unique<RegionalAlgo>("Oregon", config));
+        regions.push_back(make_unique<RegionalAlgo>("London", config));
+        regions.push_back(make_unique<RegionalAlgo>("Singapore", config));
+    }
+    catch (const std::exception &error)
+    {
+        cerr << error.what() << endl;
+        return 1;
+    }
+
+    if (global)
+    {
+        for (auto& region : regions) {
+            region->attachCoordinator(&coordinator);
+        }
+    }
 
 
     // Launch a thread for each region
     for (auto& region : regions) {
-        threads.emplace_back([&region]() { region->messageReceiver(); });  // Pass the region name to each thread
+        threads.emplace_back([&region, &transport]() { region->messageReceiver(*transport); });  // Pass the region name to each thread
+    }
+    if (inProcess)
+    {
+        unsigned int seed = random_device()();
+        for (size_t i = 0; i < regions.size(); ++i)
+        {
+            threads.emplace_back(generateRequests, regions[i]->regionName, seed + i, ArrivalOptions(), std::ref(*transport));
+        }
     }
     //regions[0]->messageReceiver();
 
@@ -0,0 +1,215 @@
+#include <iostream> // std::cout.
+#include <string>   // std::stoi.
+#include <vector>   // vectors.
+#include <thread>   // threads.
+#include <algorithm>
+#include "discreteEventSim.h"
+#include "lowerBoundSolver.h"
+using namespace std;
+
+// Simulates whole days of traffic on a virtual clock instead of waiting for
+// the request generator.
+// Usage: simulateDays [days] [seed] [--quiet] [--policy=status-order|first-fit|best-fit|worst-fit|dot-product]
+//                     [--model-boot] [--predictive] [--consolidate] [--right-size] [--global] [--shards=N]
+//                     [--traffic=uniform|poisson|diurnal|bursty] [--phases=end:minPause-maxPause,...]
+//                     [--record=prefix] [--replay=prefix] [--metrics=prefix|unix:path] [--lower-bound]
+//                     [--snapshot=prefix] [--max-servers=N] [--budget=USD/hour] [--admission-queue=N]
+//                     [--priorities=high:share,low:share] [--max-wait=ms]
+// --metrics exports a metrics snapshot of every region at each end of day,
+// --snapshot saves each region's fleet to <prefix>_<region>.fleet at each end of day.
+// --lower-bound solves the offline lower bound of every day of the replayed
+// traces first and adds the competitive ratio to the end of day reports.
+// --max-servers and --budget cap each region's fleet, requests that find no
+// room wait in an admission queue of --admission-queue requests, the most
+// urgent first, and give up after --max-wait milliseconds
+int main(int argc, char *argv[])
+{
+    int days = argc > 1 ? stoi(argv[1]) : 1;
+    unsigned int seed = argc > 2 ? stoul(argv[2]) : 1;
+    bool quiet = false;
+    bool global = false;
+    bool lowerBound = false;
+    RegionConfig config;
+    ArrivalOptions arrivals;
+    for (int i = 3; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (option == "--quiet")
+        {
+            quiet = true;
+        }
+        else if (option.rfind("--policy=", 0) == 0)
+        {
+            auto policy = parsePlacementPolicy(option.substr(9));
+            if (!policy)
+            {
+                cerr << "Unknown placement policy: " << option.substr(9) << endl;
+                return 1;
+            }
+            config.placementPolicy = *policy;
+        }
+        else if (option == "--model-boot")
+        {
+            config.modelServerBoot = true;
+        }
+        else if (option == "--predictive")
+        {
+            config.predictiveScaling = true;
+        }
+        else if (option == "--consolidate")
+        {
+            config.consolidation = true;
+        }
+        else if (option == "--right-size")
+        {
+            config.rightSizing = true;
+        }
+        else if (option == "--global")
+        {
+            global = true;
+        }
+        else if (option.rfind("--shards=", 0) == 0)
+        {
+            config.shardCount = std::max(1, stoi(option.substr(9)));
+        }
+        else if (option.rfind("--traffic=", 0) == 0)
+        {
+            auto model = TrafficProfile::parseArrivalModel(option.substr(10));
+            if (!model)
+            {
+                cerr << "Unknown traffic model: " << option.substr(10) << endl;
+                return 1;
+            }
+            arrivals.profile.model = *model;
+        }
+        else if (option.rfind("--phases=", 0) == 0)
+        {
+            auto phases = TrafficProfile::parsePhases(option.substr(9));
+            if (!phases)
+            {
+                cerr << "Invalid traffic phases: " << option.substr(9) << endl;
+                return 1;
+            }
+            arrivals.profile.phases = *phases;
+        }
+        else if (option.rfind("--priorities=", 0) == 0)
+        {
+            auto shares = TrafficProfile::parsePriorityShares(option.substr(13));
+            if (!shares)
+            {
+                cerr << "Invalid priority shares: " << option.substr(13) << endl;
+                return 1;
+            }
+            arrivals.profile.highPriorityShare = shares->first;
+            arrivals.profile.lowPriorityShare = shares->second;
+        }
+        else if (option.rfind("--max-wait=", 0) == 0)
+        {
+            arrivals.profile.maxWaitMs = std::max(0, stoi(option.substr(11)));
+        }
+        else if (option.rfind("--record=", 0) == 0)
+        {
+            arrivals.recordPrefix = option.substr(9);
+        }
+        else if (option.rfind("--replay=", 0) == 0)
+        {
+            arrivals.replayPrefix = option.substr(9);
+        }
+        else if (option.rfind("--metrics=", 0) == 0)
+        {
+            config.metricsTarget = option.substr(10);
+        }
+        else if (option.rfind("--snapshot=", 0) == 0)
+        {
+            config.snapshotPrefix = option.substr(11);
+        }
+        else if (option.rfind("--max-servers=", 0) == 0)
+        {
+            config.maxServers = std::max(0, stoi(option.substr(14)));
+        }
+        else if (option.rfind("--budget=", 0) == 0)
+        {
+            config.maxCostPerHour = std::max(0.0, stod(option.substr(9)));
+        }
+        else if (option.rfind("--admission-queue=", 0) == 0)
+        {
+            config.admissionQueueDepth = std::max(0, stoi(option.substr(18)));
+        }
+        else if (option == "--lower-bound")
+        {
+            lowerBound = true;
+        }
+        else
+        {
+            cerr << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+
+    // The per-event console output dominates the runtime of a fast simulation,
+    // the real time and end of day logs are still written to their files
+    if (quiet)
+    {
+        cout.setstate(ios::failbit);
+    }
+
+    vector<string> regionNames = {"Oregon", "London", "Singapore"};
+
+    // The bound needs the whole trace up front, and spilled requests would
+    // move cost between the regions
+    if (lowerBound && (arrivals.replayPrefix.empty() || global))
+    {
+        cerr << "--lower-bound needs --replay and cannot be combined with --global" << endl;
+        return 1;
+    }
+    vector<RegionConfig> regionConfigs(regionNames.size(), config);
+    if (lowerBound)
+    {
+        for (size_t i = 0; i < regionNames.size(); ++i)
+        {
+            LowerBoundOptions boundOptions;
+            boundOptions.region = *Constants::parseRegion(regionNames[i]);
+            boundOptions.processCapacity = config.processCapacity;
+            boundOptions.resourceConstraints = config.placementPolicy != PlacementPolicy::StatusOrder;
+            try
+            {
+                TraceReader trace(traceFileName(arrivals.replayPrefix, regionNames[i]));
+                regionConfigs[i].dailyCostLowerBounds = LowerBoundSolver(boundOptions).solve(trace);
+            }
+            catch (const std::exception &error)
+            {
+                cerr << error.what() << endl;
+                return 1;
+            }
+        }
+    }
+
+    // Coordinated regions hand requests to each other, so they share one
+    // clock and run on one thread
+    if (global)
+    {
+        DiscreteEventSimulation simulation(regionNames, seed, config, true, arrivals);
+        simulation.runDays(days);
+        return 0;
+    }
+
+    // Create a vector to store the threads
+    vector<thread> threads;
+
+    // The regions are independent so each one is simulated on its own thread
+    for (size_t i = 0; i < regionNames.size(); ++i)
+    {
+        threads.emplace_back([&regionNames, i, days, seed, &regionConfigs, &arrivals]()
+                             {
+            DiscreteEventSimulation simulation(regionNames[i], seed + i, regionConfigs[i], arrivals);
+            simulation.runDays(days); });
+    }
+
+    // Wait for all threads to finish
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    return 0;
+}
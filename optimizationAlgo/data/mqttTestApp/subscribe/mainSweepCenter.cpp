@@ -0,0 +1,163 @@
+#include <iostream> // std::cout.
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "policySweep.h"
+using namespace std;
+
+// Runs the discrete-event simulation for every combination of the listed
+// parameters and seeds on all cores, and writes the cost, holdup and scaling
+// figures to <prefix>_runs.csv (one line per run, as runs finish) and
+// <prefix>_summary.csv (distributions per combination, cheapest first).
+// Usage: sweepPolicies [--regions=Oregon,...] [--policies=status-order,...] [--min-scale=1,...]
+//                      [--max-scale=1,...] [--scale-up-status=2,3] [--headroom=0.2,...]
+//                      [--seeds=N] [--seed=N] [--days=N] [--threads=N] [--out=prefix]
+//                      [--model-boot] [--predictive] [--consolidate] [--right-size] [--shards=N]
+//                      [--traffic=uniform|poisson|diurnal|bursty] [--phases=end:minPause-maxPause,...]
+// Every list option takes comma separated values. --days is the length of
+// each run, so a sweep simulates combinations x seeds x days days in total
+
+// Comma separated values, each converted with parse
+template <typename T>
+static vector<T> parseList(const string &text, T (*parse)(const string &))
+{
+    vector<T> values;
+    stringstream stream(text);
+    string item;
+    while (getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            values.push_back(parse(item));
+        }
+    }
+    return values;
+}
+
+static string asString(const string &text)
+{
+    return text;
+}
+
+static double asDouble(const string &text)
+{
+    return stod(text);
+}
+
+static int asInt(const string &text)
+{
+    return stoi(text);
+}
+
+int main(int argc, char *argv[])
+{
+    SweepOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        string option = argv[i];
+        if (option.rfind("--regions=", 0) == 0)
+        {
+            options.regions = parseList(option.substr(10), asString);
+        }
+        else if (option.rfind("--policies=", 0) == 0)
+        {
+            options.policies = parseList(option.substr(11), asString);
+        }
+        else if (option.rfind("--min-scale=", 0) == 0)
+        {
+            options.minThresholdScales = parseList(option.substr(12), asDouble);
+        }
+        else if (option.rfind("--max-scale=", 0) == 0)
+        {
+            options.maxThresholdScales = parseList(option.substr(12), asDouble);
+        }
+        else if (option.rfind("--scale-up-status=", 0) == 0)
+        {
+            options.scaleUpStatuses = parseList(option.substr(18), asInt);
+        }
+        else if (option.rfind("--headroom=", 0) == 0)
+        {
+            options.scalingHeadrooms = parseList(option.substr(11), asDouble);
+        }
+        else if (option.rfind("--seeds=", 0) == 0)
+        {
+            options.seeds = std::max(1, stoi(option.substr(8)));
+        }
+        else if (option.rfind("--seed=", 0) == 0)
+        {
+            options.firstSeed = stoul(option.substr(7));
+        }
+        else if (option.rfind("--days=", 0) == 0)
+        {
+            options.daysPerRun = std::max(1, stoi(option.substr(7)));
+        }
+        else if (option.rfind("--threads=", 0) == 0)
+        {
+            options.threads = std::max(1, stoi(option.substr(10)));
+        }
+        else if (option.rfind("--out=", 0) == 0)
+        {
+            options.outputPrefix = option.substr(6);
+        }
+        else if (option == "--model-boot")
+        {
+            options.baseConfig.modelServerBoot = true;
+        }
+        else if (option == "--predictive")
+        {
+            options.baseConfig.predictiveScaling = true;
+        }
+        else if (option == "--consolidate")
+        {
+            options.baseConfig.consolidation = true;
+        }
+        else if (option == "--right-size")
+        {
+            options.baseConfig.rightSizing = true;
+        }
+        else if (option.rfind("--shards=", 0) == 0)
+        {
+            options.baseConfig.shardCount = std::max(1, stoi(option.substr(9)));
+        }
+        else if (option.rfind("--traffic=", 0) == 0)
+        {
+            auto model = TrafficProfile::parseArrivalModel(option.substr(10));
+            if (!model)
+            {
+                cerr << "Unknown traffic model: " << option.substr(10) << endl;
+                return 1;
+            }
+            options.arrivals.profile.model = *model;
+        }
+        else if (option.rfind("--phases=", 0) == 0)
+        {
+            auto phases = TrafficProfile::parsePhases(option.substr(9));
+            if (!phases)
+            {
+                cerr << "Invalid traffic phases: " << option.substr(9) << endl;
+                return 1;
+            }
+            options.arrivals.profile.phases = *phases;
+        }
+        else
+        {
+            cerr << "Unknown option: " << option << endl;
+            return 1;
+        }
+    }
+
+    // Every run prints its end of day reports, nobody reads them here
+    cout.setstate(ios::failbit);
+    try
+    {
+        PolicySweep sweep(options);
+        return sweep.run() > 0 ? 1 : 0;
+    }
+    catch (const std::exception &error)
+    {
+        cerr << error.what() << endl;
+        return 1;
+    }
+}
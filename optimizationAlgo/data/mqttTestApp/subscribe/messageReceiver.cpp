@@ -1,282 +1,1903 @@
-#include <ostream> // std::cout.
+#include <iostream> // std::cout.
 #include <fstream> // std::ofstream.
 #include <vector>  // vectors.
 #include <thread>  // threads.
 #include <functional>
 #include <sstream>
-#include <future>
 #include <chrono>
 #include <mutex>
-#include "mqttSubscribeMessage.h"
+#include <stdexcept>
+#include <string_view>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
 #include "messageReceiver.h"
 #include "appConst.h"
+#include "reportFormat.h"
+#include "../common/trafficProfile.h"
 using namespace std;
 using namespace Constants;
 
+// Server::snapshotChange flags, a change of the processes always comes with
+// one of the record
+static constexpr int snapshotRecordChanged = 1;
+static constexpr int snapshotProcessesChanged = 3;
+
+// Only booted servers below their absolute process limit (status 0, 1 or 2)
+// that are not being replaced may take requests
+static bool acceptsRequests(const Server *server)
+{
+    return server->serverStatus >= 0 && server->serverStatus <= 2 && !server->booting && !server->retiring;
+}
+
 //////////////////
 // Regional algorithm class implementation
-RegionalAlgo::RegionalAlgo(string regionNameInput)
+RegionalAlgo::RegionalAlgo(string regionNameInput, RegionConfig configInput, std::shared_ptr<SimClock> clockInput)
+    : config(configInput),
+      clock(clockInput),
+      eventLog(config.writeLogFiles ? regionNameInput + "_realTime_events" : "", config.eventLogCapacity, config.dropEventsWhenFull),
+      demandForecaster((int)std::ceil(TrafficProfile::dayEnd / config.forecastTickSeconds) + 1),
+      processScheduler([this](const ScheduledEvent &event)
+                       { handleScheduledEvent(event); }),
+      placementPool(config.placementThreads, config.placementQueueDepth, [this](vector<PlacementRequest> &batch)
+                    { placeRequests(batch); }),
+      admissionQueue(config.admissionQueueDepth)
+{
+    regionName = regionNameInput;
+    // The name is only used for topics and file names, lookups use the enum
+    auto regionOpt = Constants::parseRegion(regionName);
+    if (!regionOpt)
+    {
+        throw std::invalid_argument("Unknown region: " + regionName);
+    }
+    region = *regionOpt;
+    for (const Capacity &capacity : config.processCapacity)
+    {
+        if (capacity.minThreshold < 0 || capacity.minThreshold > capacity.maxThreshold || capacity.maxThreshold < 1 || capacity.maxThreshold >= capacity.absoluteLimit)
+        {
+            throw std::invalid_argument("Process capacity thresholds must satisfy 0 <= min <= max < absolute limit and max >= 1");
+        }
+    }
+    if (config.scaleUpStatus != 2 && config.scaleUpStatus != 3)
+    {
+        throw std::invalid_argument("The scale up status must be 2 or 3");
+    }
+    if (config.maxServers < 0 || config.maxCostPerHour < 0 || config.backpressureLowWater > config.backpressureHighWater)
+    {
+        throw std::invalid_argument("Fleet limits must not be negative and the backpressure low water mark must not exceed the high one");
+    }
+    for (int i = 0; i < std::max(1, config.shardCount); ++i)
+    {
+        shards.push_back(std::make_unique<RegionShard>(i, config.placementPolicy));
+    }
+    nextShard = 0;
+    arrivalsSinceTick = 0;
+    coordinator = nullptr;
+    coordinatorIndex = -1;
+    freeSlots = 0;
+    serverCount = 0;
+    runningProcesses = 0;
+    hourlyCostMicroUsd = 0;
+    backpressured = false;
+    malformedRequests = 0;
+    snapshotDirty = false;
+    stoppingReports = false;
+    nextServerId = 0;
+    completedDays = 0;
+    endOfDayReportFile = std::make_shared<std::ofstream>();
+    if (config.writeLogFiles)
+    {
+        endOfDayReportFile->open(regionName + "_endOfDay_log", std::ios::trunc);
+    }
+    if (config.predictiveScaling)
+    {
+        processScheduler.scheduleEvent(ScheduledEventKind::MaintenanceTick, clock->now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(config.forecastTickSeconds)));
+    }
+    if (config.consolidation)
+    {
+        processScheduler.scheduleEvent(ScheduledEventKind::ConsolidationTick, clock->now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(config.consolidationIntervalSeconds)));
+    }
+    if (config.rightSizing)
+    {
+        processScheduler.scheduleEvent(ScheduledEventKind::RightSizingTick, clock->now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(config.rightSizingIntervalSeconds)));
+    }
+    // On a virtual clock the discrete-event simulation dispatches completions itself
+    if (!clock->isVirtual())
+    {
+        processScheduler.start();
+    }
+    if (!config.metricsTarget.empty())
+    {
+        metricsExporter = std::make_unique<MetricsExporter>(MetricsExporter::targetFor(config.metricsTarget, regionName));
+        if (!clock->isVirtual() && config.metricsIntervalSeconds > 0)
+        {
+            metricsExporter->start(config.metricsIntervalSeconds, [this]()
+                                   { return metricsLine(); });
+        }
+    }
+    if (!config.snapshotPrefix.empty())
+    {
+        snapshotWriter = std::make_unique<FleetSnapshotWriter>(FleetSnapshotWriter::pathFor(config.snapshotPrefix, regionName));
+        // Restored before the first periodic snapshot could replace the file with an empty fleet
+        if (config.restoreSnapshot && std::ifstream(snapshotWriter->getPath()).good())
+        {
+            auto restoreStart = chrono::steady_clock::now();
+            restoreFleet(snapshotWriter->getPath());
+            cout << "Restored " << serverCount.load() << " servers and " << runningProcesses.load() << " processes of " << regionName << " in "
+                 << chrono::duration<double, milli>(chrono::steady_clock::now() - restoreStart).count() << " ms" << endl;
+        }
+        if (!clock->isVirtual() && config.snapshotIntervalSeconds > 0)
+        {
+            snapshotWriter->start(config.snapshotIntervalSeconds, [this](FleetImage &image)
+                                  { captureFleet(image); });
+        }
+    }
+    if (!clock->isVirtual() && config.reportIntervalSeconds > 0)
+    {
+        auto interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(config.reportIntervalSeconds));
+        reportThread = thread([this, interval]()
+                              {
+                                  std::unique_lock<std::mutex> lock(reportMutex);
+                                  while (!reportCondition.wait_for(lock, interval, [this]()
+                                                                   { return stoppingReports; }))
+                                  {
+                                      lock.unlock();
+                                      regionalReport();
+                                      lock.lock();
+                                  } });
+    }
+};
+
+RegionalAlgo::~RegionalAlgo()
+{
+    // Stop placing and completing processes before the servers they point to
+    // are released, and exporting before the metrics go
+    if (metricsExporter)
+    {
+        metricsExporter->stop();
+    }
+    if (snapshotWriter)
+    {
+        snapshotWriter->stop();
+    }
+    {
+        std::lock_guard<std::mutex> lock(reportMutex);
+        stoppingReports = true;
+    }
+    reportCondition.notify_all();
+    if (reportThread.joinable())
+    {
+        reportThread.join();
+    }
+    placementPool.stop();
+    processScheduler.stop();
+}
+
+// Continuously listening to requests coming from outside and handling the requests
+void RegionalAlgo::messageReceiver(Transport &transport)
+{
+
+    auto subscriber = transport.createSubscriber("subscribe_" + regionName, regionName);
+    auto backpressurePublisher = transport.createPublisher("backpressure_" + regionName, backpressureTopic(regionName));
+    placementPool.start();
+
+    bool running = true;
+    while (running)
+    {
+        // Holds the incoming message, valid until the next receive.
+        ReceivedMessage message;
+
+        // Block until a message arrives or the timeout passes, so an idle
+        // region does not spin on the queue
+        if (!subscriber->receive(message, chrono::milliseconds(Constants::receiveTimeoutMs)))
+        {
+            signalBackpressure(*backpressurePublisher);
+            continue;
+        }
+
+        // Drain whatever else is already queued and hand the requests to the
+        // placement pool. Control messages wait for the pool to finish so that
+        // requests that arrived before an END OF DAY are counted in that day
+        int batchSize = 0;
+        do
+        {
+            // Requests are read straight from the payload buffer, only
+            // control messages are looked at as text
+            ++batchSize;
+            ThreadMetrics *threadMetrics = localMetrics();
+            if (threadMetrics)
+            {
+                threadMetrics->add(MetricCounter::MessagesReceived);
+            }
+
+            if (isRequestPayload(message.data, message.size))
+            {
+                auto now = chrono::steady_clock::now();
+                size_t requestCount = message.size / sizeof(RequestMessage);
+                size_t malformed = 0;
+                for (size_t i = 0; i < requestCount; ++i)
+                {
+                    PlacementRequest placement;
+                    if (decodeRequestMessage(message.data, message.size, i, placement.request))
+                    {
+                        placement.enqueuedAt = now;
+                        placementPool.submit(placement);
+                    }
+                    else
+                    {
+                        ++malformed;
+                    }
+                }
+                if (malformed > 0)
+                {
+                    malformedRequests += malformed;
+                    cerr << "Skipping " << malformed << " malformed requests of " << requestCount << " in a message on " << regionName << endl;
+                }
+                if (threadMetrics)
+                {
+                    threadMetrics->add(MetricCounter::RequestsReceived, requestCount - malformed);
+                    threadMetrics->add(MetricCounter::RequestsMalformed, malformed);
+                    threadMetrics->record(MetricHistogram::IngestNs, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - now).count());
+                }
+                continue;
+            }
+
+            std::string_view messageString(message.data, message.size);
+            if (messageString == "END OF DAY")
+            {
+                placementPool.waitIdle();
+                calculateCostBenefitRatio();
+            }
+            // Here, we break the loop and exit the program if a `quit` is received.
+            else if (messageString == "quit")
+            {
+                running = false;
+                break;
+            }
+            else
+            {
+                cerr << "Ignoring unknown message of " << message.size << " bytes on " << regionName << endl;
+            }
+        } while (batchSize < Constants::maxReceiveBatch && subscriber->tryReceive(message));
+        signalBackpressure(*backpressurePublisher);
+    }
+
+    placementPool.waitIdle();
+    placementPool.stop();
+    // A restart picks up the fleet as it was when the consumer quit
+    if (snapshotWriter)
+    {
+        snapshotWriter->stop();
+        try
+        {
+            saveFleet();
+        }
+        catch (const std::exception &error)
+        {
+            cerr << error.what() << endl;
+        }
+    }
+}
+
+// Ask the publisher to hold back requests once the admission queue is nearly
+// full and to go on once it has drained. Only the receiver thread calls it
+void RegionalAlgo::signalBackpressure(Publisher &publisher)
+{
+    size_t queued = admissionQueue.size();
+    double fill = admissionQueue.getCapacity() > 0 ? (double)queued / admissionQueue.getCapacity() : 0;
+    if (!backpressured && queued > 0 && fill >= config.backpressureHighWater)
+    {
+        backpressured = true;
+        publisher.publish("PAUSE");
+    }
+    else if (backpressured && fill <= config.backpressureLowWater)
+    {
+        backpressured = false;
+        publisher.publish("RESUME");
+    }
+}
+
+// As the requests come in adding the processes to servers
+void RegionalAlgo::addProcessToServer(const RequestMessage &request)
+{
+    {
+        std::unique_lock<std::mutex> lock;
+        RegionShard &shard = acquireShard(lock);
+        if (placeRequestLocked(shard, request, coordinator != nullptr))
+        {
+            return;
+        }
+    }
+    spillOrPlace(request);
+}
+
+// Called by the placement pool workers with a batch of waiting requests,
+// the whole batch is placed under a single shard lock, taken on whichever
+// shard is free. Requests that would make the region scale up while another
+// region has room are handed over after the lock is released, so no thread
+// ever holds the locks of two regions
+void RegionalAlgo::placeRequests(vector<PlacementRequest> &batch)
+{
+    auto batchStart = chrono::steady_clock::now();
+    vector<RequestMessage> deferred;
+    {
+        std::unique_lock<std::mutex> lock;
+        RegionShard &shard = acquireShard(lock);
+        for (const auto &placement : batch)
+        {
+            if (!placeRequestLocked(shard, placement.request, coordinator != nullptr))
+            {
+                deferred.push_back(placement.request);
+            }
+        }
+    }
+    for (const auto &request : deferred)
+    {
+        spillOrPlace(request);
+    }
+    // Timing every request would cost more than placing it, so the batch
+    // time is spread evenly over its requests
+    if (ThreadMetrics *threadMetrics = localMetrics(); threadMetrics && !batch.empty())
+    {
+        uint64_t batchNs = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - batchStart).count();
+        threadMetrics->record(MetricHistogram::PlacementNs, batchNs / batch.size(), batch.size());
+    }
+}
+
+void RegionalAlgo::attachCoordinator(GlobalCoordinator *coordinatorInput)
+{
+    auto locks = lockAllShards();
+    coordinator = coordinatorInput;
+    coordinatorIndex = coordinator->registerRegion(this);
+    publishSnapshot();
+}
+
+bool RegionalAlgo::addSpilledRequest(const RequestMessage &request)
+{
+    std::unique_lock<std::mutex> lock;
+    RegionShard &shard = acquireShard(lock);
+    // Requests waiting here for room go before any handed over one
+    if (admissionQueue.size() > 0 || !placeOnExistingServer(shard, request))
+    {
+        return false;
+    }
+    ++shard.totals.spilledIn;
+    if (ThreadMetrics *threadMetrics = localMetrics())
+    {
+        threadMetrics->add(MetricCounter::RequestsSpilledIn);
+    }
+    return true;
+}
+
+// Hand the request to the region the coordinator picks, or place it here if
+// the other regions filled up in the meantime. The caller holds no shard lock
+void RegionalAlgo::spillOrPlace(const RequestMessage &request)
+{
+    float latencyMs = 0;
+    RegionalAlgo *target = coordinator->findSpillTarget(coordinatorIndex, latencyMs);
+    bool spilled = target && target->addSpilledRequest(request);
+
+    std::unique_lock<std::mutex> lock;
+    RegionShard &shard = acquireShard(lock);
+    if (spilled)
+    {
+        ++shard.totals.spilledOut;
+        shard.totals.spillLatencyMs += latencyMs;
+        if (ThreadMetrics *threadMetrics = localMetrics())
+        {
+            threadMetrics->add(MetricCounter::RequestsSpilledOut);
+        }
+    }
+    else
+    {
+        placeRequestLocked(shard, request, false);
+    }
+}
+
+// Publish the free capacity totals of the region to the coordinator. The
+// coordinator slot takes one writer at a time: a shard that finds another one
+// publishing leaves its change marked and the publishing shard picks it up
+// before letting go, so placement never waits for a publish
+void RegionalAlgo::publishSnapshot()
+{
+    if (!coordinator)
+    {
+        return;
+    }
+    snapshotDirty.store(true);
+    while (snapshotDirty.load() && snapshotMutex.try_lock())
+    {
+        snapshotDirty.store(false);
+        coordinator->publish(coordinatorIndex, {freeSlots.load(), serverCount.load(), runningProcesses.load(), 0});
+        snapshotMutex.unlock();
+    }
+}
+
+// Lock the first shard that is free, starting from a different shard for
+// every placement, and wait for that starting shard if all of them are busy
+RegionShard &RegionalAlgo::acquireShard(std::unique_lock<std::mutex> &lock)
+{
+    size_t start = nextShard.fetch_add(1, memory_order_relaxed) % shards.size();
+    for (size_t i = 0; i < shards.size(); ++i)
+    {
+        RegionShard &shard = *shards[(start + i) % shards.size()];
+        std::unique_lock<std::mutex> attempt(shard.mutex, std::try_to_lock);
+        if (attempt.owns_lock())
+        {
+            lock = std::move(attempt);
+            return shard;
+        }
+    }
+    RegionShard &shard = *shards[start];
+    lock = std::unique_lock<std::mutex>(shard.mutex);
+    return shard;
+}
+
+// Lock every shard in index order, for work that looks at the whole fleet
+vector<std::unique_lock<std::mutex>> RegionalAlgo::lockAllShards()
+{
+    vector<std::unique_lock<std::mutex>> locks;
+    for (auto &shard : shards)
+    {
+        locks.emplace_back(shard->mutex);
+    }
+    return locks;
+}
+
+RegionShard &RegionalAlgo::shardOf(Server *server)
+{
+    return *shards[server->getShardIndex()];
+}
+
+// Shard with the fewest servers, new servers that are not tied to a placement
+// go there. The caller holds every shard lock
+RegionShard &RegionalAlgo::leastLoadedShard()
+{
+    RegionShard *leastLoaded = shards[0].get();
+    size_t fewestServers = SIZE_MAX;
+    for (auto &shard : shards)
+    {
+        size_t servers = shard->serverCount();
+        if (servers < fewestServers)
+        {
+            leastLoaded = shard.get();
+            fewestServers = servers;
+        }
+    }
+    return *leastLoaded;
+}
+
+// Place one request, the caller holds the shard lock. Returns false without
+// placing it when the region would have to scale up, spilling is allowed and
+// the coordinator knows a region with room. The request only waits in the
+// admission queue once no shard has room and no other region takes it
+bool RegionalAlgo::placeRequestLocked(RegionShard &shard, const RequestMessage &request, bool allowSpill)
+{
+    // Requests already waiting for room go first, in order of urgency
+    admitQueuedRequests(shard, true);
+
+    if (placeOnExistingServer(shard, request))
+    {
+        return true;
+    }
+
+    if (allowSpill)
+    {
+        float latencyMs = 0;
+        if (coordinator->findSpillTarget(coordinatorIndex, latencyMs))
+        {
+            return false;
+        }
+    }
+
+    // Need to add a new server. Requests still waiting mean the fleet is at
+    // its limits, a new server would go to them first anyway
+    Server *targetServer = admissionQueue.size() == 0 ? createServer(shard, InstanceType::c08) : nullptr;
+    if (!targetServer)
+    {
+        // The fleet is at its limits, wait for a process to complete
+        queueRequest(shard, request);
+        return true;
+    }
+    ++shard.totals.scalings;
+    launchRequest(shard, targetServer, request);
+    return true;
+}
+
+// Start the request on a server of the region that has room for it, without
+// launching one. The caller holds the shard lock
+bool RegionalAlgo::placeOnExistingServer(RegionShard &shard, const RequestMessage &request)
+{
+    Server *targetServer = selectServer(shard, request);
+
+    // Waiting for a server that is already booting is never slower than
+    // booting a new one
+    if (!targetServer && config.modelServerBoot)
+    {
+        targetServer = selectBootingServer(shard, request);
+    }
+
+    if (targetServer)
+    {
+        launchRequest(shard, targetServer, request);
+        return true;
+    }
+
+    // Use the room of a shard that nobody is working on before scaling up. A
+    // shard without servers opens its own instead, otherwise every server
+    // would end up in the first shard and the others would only ever steal
+    return shards.size() > 1 && shard.serverCount() > 0 && stealPlacement(shard, request);
+}
+
+// Put a request that found no room into the admission queue, or turn it or a
+// less urgent one away if the queue is full. The caller holds the shard lock
+void RegionalAlgo::queueRequest(RegionShard &shard, const RequestMessage &request)
+{
+    QueuedRequest displaced;
+    AdmissionResult result = admissionQueue.push(request, clock->now(), displaced);
+    ThreadMetrics *threadMetrics = localMetrics();
+    if (result != AdmissionResult::Queued)
+    {
+        const RequestMessage &turnedAway = result == AdmissionResult::Rejected ? request : displaced.request;
+        ++shard.totals.rejectedRequests[static_cast<int>(requestPriority(turnedAway))];
+        if (threadMetrics)
+        {
+            threadMetrics->add(MetricCounter::RequestsRejected);
+        }
+    }
+}
+
+// Start queued requests, the most urgent first, for as long as the shard or,
+// with allowSteal, a free other shard has room for them or the fleet limits
+// allow another server. Requests whose deadline passed are dropped. The
+// caller holds the shard lock, and no other one when stealing
+void RegionalAlgo::admitQueuedRequests(RegionShard &shard, bool allowSteal)
+{
+    if (admissionQueue.size() == 0)
+    {
+        return;
+    }
+    auto now = clock->now();
+    int expired[requestPriorityCount] = {};
+    QueuedRequest next;
+    while (admissionQueue.pop(now, next, expired))
+    {
+        bool placed = false;
+        if (allowSteal)
+        {
+            placed = placeOnExistingServer(shard, next.request);
+        }
+        else
+        {
+            Server *targetServer = selectServer(shard, next.request);
+            if (!targetServer && config.modelServerBoot)
+            {
+                targetServer = selectBootingServer(shard, next.request);
+            }
+            if (targetServer)
+            {
+                launchRequest(shard, targetServer, next.request);
+                placed = true;
+            }
+        }
+        if (!placed)
+        {
+            Server *targetServer = createServer(shard, InstanceType::c08);
+            if (!targetServer)
+            {
+                admissionQueue.requeue(next);
+                break;
+            }
+            ++shard.totals.scalings;
+            launchRequest(shard, targetServer, next.request);
+        }
+        // Counted once the request leaves the queue, so the metric and the
+        // end of day report agree
+        double waitSeconds = chrono::duration<double>(now - next.enqueuedAt).count();
+        ++shard.totals.queuedRequests;
+        shard.totals.queueWaitSeconds += waitSeconds;
+        shard.totals.longestQueueWaitSeconds = std::max(shard.totals.longestQueueWaitSeconds, waitSeconds);
+        if (ThreadMetrics *threadMetrics = localMetrics())
+        {
+            threadMetrics->add(MetricCounter::RequestsQueued);
+            threadMetrics->record(MetricHistogram::AdmissionWaitMs, (uint64_t)(waitSeconds * 1000));
+        }
+    }
+    int expiredCount = 0;
+    for (int i = 0; i < requestPriorityCount; ++i)
+    {
+        shard.totals.expiredRequests[i] += expired[i];
+        expiredCount += expired[i];
+    }
+    if (ThreadMetrics *threadMetrics = localMetrics(); threadMetrics && expiredCount > 0)
+    {
+        threadMetrics->add(MetricCounter::RequestsExpired, expiredCount);
+    }
+}
+
+// Try the other shards without waiting for any of them, and place the request
+// on the first one that is free and has a booted server for it. Only
+// try_lock is used while the home shard is held, so shards never deadlock
+bool RegionalAlgo::stealPlacement(RegionShard &homeShard, const RequestMessage &request)
+{
+    for (size_t i = 1; i < shards.size(); ++i)
+    {
+        RegionShard &shard = *shards[(homeShard.index + i) % shards.size()];
+        std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+        if (!lock.owns_lock())
+        {
+            continue;
+        }
+        auto targetServer = selectServer(shard, request);
+        if (targetServer)
+        {
+            launchRequest(shard, targetServer, request);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Start the request on the chosen server of the shard, the caller holds the shard lock
+void RegionalAlgo::launchRequest(RegionShard &shard, Server *targetServer, const RequestMessage &request)
+{
+    // Launching the process moves the server between the status buckets
+    // through changeServerType, which relies on the shard lock being held here
+    auto now = clock->now();
+    PoolHandle<Process> handle = shard.processPool.acquire(request.durationMs, request.vCpuMilli, request.memoryMb);
+    Process *process = shard.processPool.get(handle);
+    targetServer->launchProcess(process);
+    if (process->start > now)
+    {
+        shard.totals.processHoldup += chrono::duration<double>(process->start - now).count();
+    }
+    ++arrivalsSinceTick;
+    ++runningProcesses;
+    process->finishAt = process->start + chrono::milliseconds(process->getExecutionTimeMs());
+    processScheduler.schedule(process->finishAt, shard.index, handle);
+    refreshPlacement(targetServer);
+    ++shard.totals.processes;
+    if (ThreadMetrics *threadMetrics = localMetrics())
+    {
+        threadMetrics->add(MetricCounter::RequestsPlaced);
+    }
+    recordEvent(FleetEventKind::ProcessAdded, targetServer, targetServer->serverStatus, targetServer->serverStatus);
+}
+
+// A process reached its deadline. The lock of the shard it runs on is taken
+// before the server's processesMutex, the same order as placement, so the two
+// cannot deadlock. A migrated process was moved to a new pool slot and
+// rescheduled, so the handle of its old completion is stale and ignored
+void RegionalAlgo::completeProcess(int shardIndex, PoolHandle<Process> completedProcess)
+{
+    RegionShard &shard = *shards[shardIndex];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Process *process = shard.processPool.get(completedProcess);
+    if (!process)
+    {
+        return;
+    }
+    Server *server = process->host;
+    server->removeProcess(process);
+    shard.processPool.release(completedProcess);
+    --runningProcesses;
+    refreshPlacement(server);
+    recordEvent(FleetEventKind::ProcessRemoved, server, server->serverStatus, server->serverStatus);
+    // The freed slot, or the budget of a server that closed, goes to the queue first
+    admitQueuedRequests(shard, true);
+    releaseClosedServers(shard);
+}
+
+// Server of the shard for the request according to the placement policy,
+// nullptr if no booted server can take it. The caller holds the shard lock
+Server *RegionalAlgo::selectServer(RegionShard &shard, const RequestMessage &request)
+{
+    if (shard.placementEngine.getPolicy() == PlacementPolicy::StatusOrder)
+    {
+        return selectServerByStatus(shard);
+    }
+    int slot = shard.placementEngine.selectServer(request.vCpuMilli, request.memoryMb);
+    if (slot != -1)
+    {
+        return shard.placementEngine.serverAt(slot);
+    }
+    return nullptr;
+}
+
+// First booted server of the lowest status bucket that still accepts
+// processes, regardless of the request's demand. Returns nullptr when every
+// booted server is full
+Server *RegionalAlgo::selectServerByStatus(RegionShard &shard)
+{
+    auto booted = [](Server *server)
+    { return !server->booting && !server->retiring; };
+    for (int status = 0; status <= 2; ++status)
+    {
+        auto server = shard.serverBuckets.findFirst(status, booted);
+        if (server)
+        {
+            return server;
+        }
+    }
+    return nullptr;
+}
+
+// Earliest launched booting server that can take the request, nullptr if none can
+Server *RegionalAlgo::selectBootingServer(RegionShard &shard, const RequestMessage &request)
+{
+    bool checkDemand = shard.placementEngine.getPolicy() != PlacementPolicy::StatusOrder;
+    for (const auto &server : shard.bootingServers)
+    {
+        if (server->serverStatus < 0 || server->serverStatus > 2)
+        {
+            continue;
+        }
+        InstanceType instanceType = server->getInstanceType();
+        if (checkDemand && (Constants::usableVcpuMilli(instanceType) - server->getUsedVcpuMilli() < (int)request.vCpuMilli ||
+                            Constants::usableMemoryMb(instanceType) - server->getUsedMemoryMb() < (int)request.memoryMb))
+        {
+            continue;
+        }
+        return server;
+    }
+    return nullptr;
+}
+
+// Route an entry of the process scheduler that became due
+void RegionalAlgo::handleScheduledEvent(const ScheduledEvent &event)
+{
+    switch (event.kind)
+    {
+    case ScheduledEventKind::ProcessCompletion:
+        completeProcess(event.shard, event.process);
+        break;
+    case ScheduledEventKind::ServerReady:
+        markServerReady(event.shard, event.server);
+        break;
+    case ScheduledEventKind::MaintenanceTick:
+        maintenanceTick(event.deadline);
+        break;
+    case ScheduledEventKind::ConsolidationTick:
+        consolidationTick(event.deadline);
+        break;
+    case ScheduledEventKind::RightSizingTick:
+        rightSizingTick(event.deadline);
+        break;
+    }
+}
+
+// A server finished booting, from now on it is picked like any other server.
+// A server that closed while booting left a stale handle behind
+void RegionalAlgo::markServerReady(int shardIndex, PoolHandle<Server> readyServer)
+{
+    RegionShard &shard = *shards[shardIndex];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Server *server = shard.serverPool.get(readyServer);
+    if (!server)
+    {
+        return;
+    }
+    server->booting = false;
+    shard.bootingServers.erase(std::remove(shard.bootingServers.begin(), shard.bootingServers.end(), server), shard.bootingServers.end());
+    refreshPlacement(server);
+    finishRightSizing(server);
+    admitQueuedRequests(shard, true);
+    releaseClosedServers(shard);
+}
+
+// Feed the arrivals of the last tick to the forecast, resize the fleet for
+// the demand expected once a server launched now has booted and schedule the next tick
+void RegionalAlgo::maintenanceTick(std::chrono::steady_clock::time_point tickTime)
+{
+    {
+        auto locks = lockAllShards();
+        demandForecaster.observe(arrivalsSinceTick.exchange(0));
+        scaleToForecast();
+        for (auto &shard : shards)
+        {
+            releaseClosedServers(*shard);
+        }
+    }
+    processScheduler.scheduleEvent(ScheduledEventKind::MaintenanceTick, tickTime + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(config.forecastTickSeconds)));
+}
+
+// Processes expected to run when a server launched now finishes booting: the
+// running ones that have not completed by then plus the forecast arrivals in
+// between. Servers are launched until their max thresholds cover that with
+// headroom, and empty booted servers that have been idle for too long are
+// closed as long as the rest still covers it. The caller holds every shard lock
+void RegionalAlgo::scaleToForecast()
+{
+    double tickSeconds = config.forecastTickSeconds;
+    int bootTicks = std::max(1, (int)std::ceil(Constants::averageServerBootDuration / tickSeconds));
+    double bootSeconds = bootTicks * tickSeconds;
+
+    int stillRunning = 0;
+    int capacity = 0;
+    vector<Server *> idleServers;
+    auto now = clock->now();
+    auto bootDone = now + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(bootSeconds));
+    for (auto &shard : shards)
+    {
+        for (int status = 0; status < ServerBuckets::statusCount; ++status)
+        {
+            shard->serverBuckets.forEach(status, [&](Server *server)
+                                         {
+                                             server->forEachProcess([&](Process *process)
+                                                                    {
+                                                                        if (process->finishAt > bootDone)
+                                                                        {
+                                                                            ++stillRunning;
+                                                                        } });
+                                             // Booting, retiring and full servers take no requests
+                                             if (acceptsRequests(server))
+                                             {
+                                                 capacity += config.capacityOf(server->getInstanceType()).maxThreshold;
+                                             }
+                                             if (!server->booting && server->getTotalProcessNum() == 0 &&
+                                                 chrono::duration<double>(now - server->readyAt).count() >= config.idleServerTimeoutSeconds)
+                                             {
+                                                 idleServers.push_back(server);
+                                             } });
+        }
+    }
+
+    double expectedProcesses = stillRunning + demandForecaster.forecastTotal(bootTicks);
+    int targetCapacity = (int)std::ceil(expectedProcesses * (1 + config.scalingHeadroom));
+
+    for (const auto &server : idleServers)
+    {
+        int serverCapacity = config.capacityOf(server->getInstanceType()).maxThreshold;
+        if (capacity - serverCapacity < targetCapacity)
+        {
+            continue;
+        }
+        capacity -= serverCapacity;
+        server->elapsed = chrono::duration_cast<chrono::seconds>(now - server->billedUntil).count();
+        closeServer(server);
+        server->serverStatus = -1;
+    }
+
+    // Launch the smallest type that covers the deficit, or the largest one
+    for (int launched = 0; capacity < targetCapacity && launched < config.maxPrewarmPerTick; ++launched)
+    {
+        int deficit = targetCapacity - capacity;
+        InstanceType instanceType = Constants::largestInstanceType;
+        for (int i = 0; i < Constants::instanceTypeCount; ++i)
+        {
+            if (config.processCapacity[i].maxThreshold >= deficit)
+            {
+                instanceType = static_cast<InstanceType>(i);
+                break;
+            }
+        }
+        RegionShard &shard = leastLoadedShard();
+        if (!createServer(shard, instanceType))
+        {
+            break;
+        }
+        capacity += config.capacityOf(instanceType).maxThreshold;
+        ++shard.totals.prewarmedServers;
+    }
+    for (auto &shard : shards)
+    {
+        // Every shard is locked here, so each one only admits onto its own servers
+        admitQueuedRequests(*shard, false);
+    }
+}
+
+// Publish the free capacity of a server to the placement engine, only the
+// ones acceptsRequests allows may take requests. Its free slots below the max threshold go into the coordinator
+// snapshot and its load into the shard's fleet view
+void RegionalAlgo::refreshPlacement(Server *server)
+{
+    if (server->placementSlot == -1)
+    {
+        return;
+    }
+    RegionShard &shard = shardOf(server);
+    markSnapshotChange(shard, server, snapshotProcessesChanged);
+    InstanceType instanceType = server->getInstanceType();
+    int usedVcpuMilli = server->getUsedVcpuMilli();
+    int usedMemoryMb = server->getUsedMemoryMb();
+    int freeVcpuMilli = Constants::usableVcpuMilli(instanceType) - usedVcpuMilli;
+    int freeMemoryMb = Constants::usableMemoryMb(instanceType) - usedMemoryMb;
+    bool eligible = acceptsRequests(server);
+    shard.placementEngine.updateServer(server->placementSlot, freeVcpuMilli, freeMemoryMb, eligible);
+    shard.view.publish(server->viewSlot, {server->getId(), instanceType, server->serverStatus, server->booting, server->retiring, server->getTotalProcessNum()}, usedVcpuMilli, usedMemoryMb);
+
+    int share = eligible && server->serverStatus <= 1 ? std::max(0, config.capacityOf(instanceType).maxThreshold - server->getTotalProcessNum()) : 0;
+    freeSlots += share - server->freeSlotShare;
+    server->freeSlotShare = share;
+    publishSnapshot();
+}
+
+// Create a server of the given type at the front of the serverType1 bucket.
+// When boots are modelled it only becomes ready after the boot duration
+Server *RegionalAlgo::createServer(RegionShard &shard, InstanceType instanceTypeInput)
+{
+    return createServer(shard, instanceTypeInput, config.modelServerBoot);
+}
+
+Server *RegionalAlgo::createServer(RegionShard &shard, InstanceType instanceTypeInput, bool modelBoot)
+{
+    // Count the server against the fleet limits before it exists, so shards
+    // launching at the same time cannot overshoot them together
+    int servers = ++serverCount;
+    int64_t price = priceMicroUsd(instanceTypeInput);
+    int64_t hourlyCost = hourlyCostMicroUsd += price;
+    if ((config.maxServers > 0 && servers > config.maxServers) ||
+        (config.maxCostPerHour > 0 && hourlyCost > (int64_t)std::llround(config.maxCostPerHour * 1e6)))
+    {
+        --serverCount;
+        hourlyCostMicroUsd -= price;
+        return nullptr;
+    }
+    PoolHandle<Server> handle = shard.serverPool.acquire(nextServerId++, shard.index, instanceTypeInput, config.capacityOf(instanceTypeInput), clock.get(), this);
+    Server *server = shard.serverPool.get(handle);
+    if (modelBoot)
+    {
+        server->booting = true;
+        server->readyAt = server->start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(Constants::averageServerBootDuration));
+        shard.bootingServers.push_back(server);
+        processScheduler.scheduleEvent(ScheduledEventKind::ServerReady, server->readyAt, shard.index, handle);
+    }
+    shard.serverBuckets.moveToFront(1, server);
+    server->placementSlot = shard.placementEngine.addServer(server, Constants::usableVcpuMilli(instanceTypeInput), Constants::usableMemoryMb(instanceTypeInput));
+    refreshPlacement(server);
+    recordEvent(FleetEventKind::ServerOpened, server, -1, 1);
+    if (ThreadMetrics *threadMetrics = localMetrics())
+    {
+        threadMetrics->add(MetricCounter::ServersOpened);
+        threadMetrics->transition(-1, 1);
+    }
+    return server;
+}
+
+// Hourly price of an instance type in the region in millionths of a USD,
+// counted in whole units so the fleet's cost can be summed atomically
+int64_t RegionalAlgo::priceMicroUsd(InstanceType instanceType)
+{
+    return std::llround(Constants::priceOf(region, instanceType) * 1e6);
+}
+
+// Queue a fleet event for the background writer, this never touches the disk
+void RegionalAlgo::recordEvent(FleetEventKind kind, Server *server, int oldStatus, int newStatus)
+{
+    FleetEvent event{};
+    event.timestampNs = chrono::duration_cast<chrono::nanoseconds>(clock->now().time_since_epoch()).count();
+    event.serverId = server->getId();
+    event.processCount = server->getTotalProcessNum();
+    event.kind = kind;
+    event.region = Constants::toIndex(region);
+    event.instanceType = Constants::toIndex(server->getInstanceType());
+    event.oldStatus = oldStatus;
+    event.newStatus = newStatus;
+    eventLog.record(event);
+}
+
+// Wait until every recorded fleet event is on disk
+void RegionalAlgo::flushEventLog()
+{
+    eventLog.flush();
+}
+
+// Adding a new server to the server pool of serverType1 since there is no processes in that server
+void RegionalAlgo::addServer(RegionShard &shard, InstanceType instanceTypeInput)
+{
+    if (createServer(shard, instanceTypeInput))
+    {
+        ++shard.totals.scalings;
+    }
+};
+
+// Removing servers that are no more used
+void RegionalAlgo::removeServer()
+{
+    auto locks = lockAllShards();
+    // Remove booted servers with no active processes from the serverType1 buckets
+    vector<Server *> idleServers;
+    for (auto &shard : shards)
+    {
+        shard->serverBuckets.forEach(1, [&](Server *server)
+                                     {
+                                         if (server->getTotalProcessNum() == 0 && !server->booting)
+                                         {
+                                             idleServers.push_back(server);
+                                         } });
+    }
+    auto now = clock->now();
+    for (const auto &server : idleServers)
+    {
+        server->elapsed = chrono::duration_cast<chrono::seconds>(now - server->billedUntil).count();
+        closeServer(server);
+        server->serverStatus = -1;
+    }
+    for (auto &shard : shards)
+    {
+        releaseClosedServers(*shard);
+    }
+};
+
+// Changing server's vector from one type to another depending on its occupancy.
+// It is only reached through Server::changeStatus, whose callers already hold
+// the mutex of the server's shard
+void RegionalAlgo::changeServerType(Server *serverToChange, int requestedStatus)
+{
+    RegionShard &shard = shardOf(serverToChange);
+
+    if (serverToChange->serverStatus != requestedStatus)
+    {
+        if (requestedStatus == -1)
+        {
+            closeServer(serverToChange);
+        }
+        else
+        {
+            shard.serverBuckets.moveToFront(requestedStatus, serverToChange);
+            markSnapshotChange(shard, serverToChange, snapshotRecordChanged);
+            recordEvent(FleetEventKind::StatusChanged, serverToChange, serverToChange->serverStatus, requestedStatus);
+            if (ThreadMetrics *threadMetrics = localMetrics())
+            {
+                threadMetrics->transition(serverToChange->serverStatus, requestedStatus);
+            }
+        }
+
+        // If the proccess amount in the server is increasing then create a new server with increased resource configuration (vertical scaling)
+        // and if the server resource is at maximum possible than create an identical server
+        if (requestedStatus == config.scaleUpStatus && serverToChange->serverStatus < requestedStatus && shard.serverBuckets.empty(1))
+        {
+            auto nextTypeOpt = Constants::getNextInstanceType(serverToChange->getInstanceType());
+            if (nextTypeOpt)
+            {
+                // Optional has a value, so use it
+                addServer(shard, *nextTypeOpt);
+            }
+            else
+            {
+                addServer(shard, serverToChange->getInstanceType());
+            }
+        }
+    }
+};
+
+// Run one bounded consolidation pass from the scheduler thread, away from the
+// placement workers, and schedule the next one
+void RegionalAlgo::consolidationTick(std::chrono::steady_clock::time_point tickTime)
+{
+    {
+        auto locks = lockAllShards();
+        consolidateServers();
+        for (auto &shard : shards)
+        {
+            releaseClosedServers(*shard);
+        }
+    }
+    processScheduler.scheduleEvent(ScheduledEventKind::ConsolidationTick, tickTime + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(config.consolidationIntervalSeconds)));
+}
+
+// Drain booted servers below their min threshold, the ones paying the most for
+// unused process slots first, into the relatively fullest servers that stay
+// within their max threshold and resources. A server is only drained when every one of its
+// processes has a destination and it would otherwise stay up long enough to
+// pay for the migration pauses. Servers that received processes are not
+// drained in the same pass and the last serverType1 server of each shard is kept
+// as its spare. The caller holds every shard mutex
+void RegionalAlgo::consolidateServers()
+{
+    auto now = clock->now();
+    auto wastedCost = [this](Server *server)
+    {
+        InstanceType instanceType = server->getInstanceType();
+        double utilisation = (double)server->getTotalProcessNum() / config.capacityOf(instanceType).maxThreshold;
+        return Constants::priceOf(region, instanceType) * (1 - utilisation);
+    };
+
+    vector<Server *> candidates;
+    for (auto &shard : shards)
+    {
+        shard->serverBuckets.forEach(1, [&](Server *server)
+                                     {
+                                         if (!server->booting && !server->retiring && server->getTotalProcessNum() > 0)
+                                         {
+                                             candidates.push_back(server);
+                                         } });
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [&](Server *a, Server *b)
+                     { return wastedCost(a) > wastedCost(b); });
+    if (candidates.size() > (size_t)config.maxConsolidationCandidates)
+    {
+        candidates.resize(config.maxConsolidationCandidates);
+    }
+
+    vector<Server *> destinations;
+    for (auto &shard : shards)
+    {
+        for (int status = 0; status <= 1; ++status)
+        {
+            shard->serverBuckets.forEach(status, [&](Server *server)
+                                         {
+                                             if (!server->booting && !server->retiring)
+                                             {
+                                                 destinations.push_back(server);
+                                             } });
+        }
+    }
+    // Load of the destinations including the moves planned so far
+    vector<int> plannedCount(destinations.size());
+    vector<int> plannedVcpuMilli(destinations.size());
+    vector<int> plannedMemoryMb(destinations.size());
+    for (size_t i = 0; i < destinations.size(); ++i)
+    {
+        plannedCount[i] = destinations[i]->getTotalProcessNum();
+        plannedVcpuMilli[i] = destinations[i]->getUsedVcpuMilli();
+        plannedMemoryMb[i] = destinations[i]->getUsedMemoryMb();
+    }
+
+    std::unordered_set<Server *> receivers;
+    std::unordered_set<Server *> drained;
+    int migrations = 0;
+    for (const auto &source : candidates)
+    {
+        // changeServerType scales up as soon as a server fills while the
+        // serverType1 bucket of its shard is empty, so one of them is always left in place
+        if (shardOf(source).serverBuckets.size(1) <= 1)
+        {
+            continue;
+        }
+        if (receivers.count(source) || source->serverStatus != 1)
+        {
+            continue;
+        }
+        auto processes = source->getProcesses();
+        if (migrations + (int)processes.size() > config.maxMigrationsPerCycle)
+        {
+            continue;
+        }
+        double remainingSeconds = 0;
+        for (const auto &process : processes)
+        {
+            remainingSeconds = std::max(remainingSeconds, chrono::duration<double>(process->finishAt - now).count());
+        }
+        if (remainingSeconds < config.minConsolidationGainSeconds)
+        {
+            continue;
+        }
+
+        // Plan on copies so a source that cannot be fully drained leaves no trace
+        vector<int> count = plannedCount;
+        vector<int> vCpuMilli = plannedVcpuMilli;
+        vector<int> memoryMb = plannedMemoryMb;
+        vector<size_t> plan;
+        for (const auto &process : processes)
+        {
+            int best = -1;
+            double bestFill = 0;
+            for (size_t i = 0; i < destinations.size(); ++i)
+            {
+                const auto &destination = destinations[i];
+                InstanceType instanceType = destination->getInstanceType();
+                if (destination == source || drained.count(destination) ||
+                    count[i] + 1 > config.capacityOf(instanceType).maxThreshold ||
+                    vCpuMilli[i] + process->getVcpuMilli() > Constants::usableVcpuMilli(instanceType) ||
+                    memoryMb[i] + process->getMemoryMb() > Constants::usableMemoryMb(instanceType))
+                {
+                    continue;
+                }
+                // Relative fill decides, so a large server with spare slots
+                // does not soak up the processes of cheaper ones
+                double fill = (double)count[i] / config.capacityOf(instanceType).maxThreshold;
+                if (best == -1 || fill > bestFill)
+                {
+                    best = i;
+                    bestFill = fill;
+                }
+            }
+            if (best == -1)
+            {
+                break;
+            }
+            ++count[best];
+            vCpuMilli[best] += process->getVcpuMilli();
+            memoryMb[best] += process->getMemoryMb();
+            plan.push_back(best);
+        }
+        if (plan.size() != processes.size())
+        {
+            continue;
+        }
+
+        drained.insert(source);
+        for (size_t i = 0; i < processes.size(); ++i)
+        {
+            receivers.insert(destinations[plan[i]]);
+            migrateProcess(processes[i], source, destinations[plan[i]]);
+        }
+        plannedCount = std::move(count);
+        plannedVcpuMilli = std::move(vCpuMilli);
+        plannedMemoryMb = std::move(memoryMb);
+        migrations += processes.size();
+    }
+}
+
+// Move a running process to another server. It loses migrationPauseSeconds
+// of run time, so its completion is rescheduled. It moves to a new slot in
+// the pool of the destination's shard, which leaves the completion scheduled
+// for the old slot stale. Removing the last process closes the source through
+// changeServerType. The caller holds the mutex of both servers' shards
+void RegionalAlgo::migrateProcess(Process *process, Server *source, Server *destination)
+{
+    RegionShard &sourceShard = shardOf(source);
+    RegionShard &destinationShard = shardOf(destination);
+    source->removeProcess(process);
+    refreshPlacement(source);
+    recordEvent(FleetEventKind::ProcessMigrated, source, source->serverStatus, source->serverStatus);
+
+    PoolHandle<Process> handle = destinationShard.processPool.acquire(*process);
+    sourceShard.processPool.release(sourceShard.processPool.handleOf(process));
+    Process *migrated = destinationShard.processPool.get(handle);
+    auto pause = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(config.migrationPauseSeconds));
+    migrated->finishAt += pause;
+    destination->adoptProcess(migrated);
+    processScheduler.schedule(migrated->finishAt, destinationShard.index, handle);
+    refreshPlacement(destination);
+    recordEvent(FleetEventKind::ProcessMigrated, destination, destination->serverStatus, destination->serverStatus);
+
+    ++sourceShard.totals.migrations;
+    sourceShard.totals.migrationPause += config.migrationPauseSeconds;
+    if (ThreadMetrics *threadMetrics = localMetrics())
+    {
+        threadMetrics->add(MetricCounter::ProcessesMigrated);
+    }
+}
+
+// Run one bounded right-sizing pass from the scheduler thread and schedule the next one
+void RegionalAlgo::rightSizingTick(std::chrono::steady_clock::time_point tickTime)
+{
+    {
+        auto locks = lockAllShards();
+        rightSizeServers();
+    }
+    processScheduler.scheduleEvent(ScheduledEventKind::RightSizingTick, tickTime + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(config.rightSizingIntervalSeconds)));
+}
+
+// Cheapest instance type that holds the current load of the server within its
+// max threshold with room for one more process, if it is cheaper than the
+// server's own type
+std::optional<InstanceType> RegionalAlgo::cheapestTypeFor(Server *server)
+{
+    std::optional<InstanceType> cheapest;
+    float cheapestPrice = Constants::priceOf(region, server->getInstanceType());
+    for (int i = 0; i < Constants::instanceTypeCount; ++i)
+    {
+        InstanceType instanceType = static_cast<InstanceType>(i);
+        if (server->getTotalProcessNum() + 1 > config.capacityOf(instanceType).maxThreshold ||
+            server->getUsedVcpuMilli() > Constants::usableVcpuMilli(instanceType) ||
+            server->getUsedMemoryMb() > Constants::usableMemoryMb(instanceType))
+        {
+            continue;
+        }
+        if (Constants::priceOf(region, instanceType) < cheapestPrice)
+        {
+            cheapest = instanceType;
+            cheapestPrice = Constants::priceOf(region, instanceType);
+        }
+    }
+    return cheapest;
+}
+
+// Start replacing servers whose load a cheaper type can hold, the biggest
+// saving first. Both servers run while the replacement boots, so a server is
+// only replaced when the saving until its last process finishes pays for
+// that overlap. The replacement always pays the boot duration, even when
+// boots are not modelled for placement. The replacement joins the shard of the server it
+// replaces. The caller holds every shard mutex
+void RegionalAlgo::rightSizeServers()
+{
+    auto now = clock->now();
+    double bootSeconds = Constants::averageServerBootDuration;
+    vector<pair<double, Server *>> candidates;
+    for (auto &shard : shards)
+    {
+        for (int status = 0; status <= 1; ++status)
+        {
+            shard->serverBuckets.forEach(status, [&](Server *server)
+                                         {
+                                             if (server->booting || server->retiring)
+                                             {
+                                                 return;
+                                             }
+                                             auto cheaperType = cheapestTypeFor(server);
+                                             if (!cheaperType)
+                                             {
+                                                 return;
+                                             }
+                                             double remainingSeconds = 0;
+                                             server->forEachProcess([&](Process *process)
+                                                                    { remainingSeconds = std::max(remainingSeconds, chrono::duration<double>(process->finishAt - now).count()); });
+                                             double oldPrice = Constants::priceOf(region, server->getInstanceType());
+                                             double newPrice = Constants::priceOf(region, *cheaperType);
+                                             double saving = (oldPrice - newPrice) * (remainingSeconds - bootSeconds) - newPrice * bootSeconds;
+                                             if (saving > 0)
+                                             {
+                                                 candidates.push_back({saving, server});
+                                             } });
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const pair<double, Server *> &a, const pair<double, Server *> &b)
+                     { return a.first > b.first; });
+
+    for (size_t i = 0; i < candidates.size() && i < (size_t)config.maxRightSizesPerCycle; ++i)
+    {
+        const auto &server = candidates[i].second;
+        RegionShard &shard = shardOf(server);
+        auto replacement = createServer(shard, *cheapestTypeFor(server), true);
+        if (!replacement)
+        {
+            break;
+        }
+        server->retiring = true;
+        refreshPlacement(server);
+        shard.pendingRightSizes.push_back({shard.serverPool.handleOf(replacement), shard.serverPool.handleOf(server)});
+        ++shard.totals.rightSizes;
+    }
+}
+
+// A replacement finished booting, move the processes of the server it
+// replaces over so that server closes. If new processes were placed on the
+// replacement in the meantime and the old load no longer fits, the old server
+// simply goes back into service. The caller holds the mutex of the replacement's shard
+void RegionalAlgo::finishRightSizing(Server *replacement)
+{
+    RegionShard &shard = shardOf(replacement);
+    PoolHandle<Server> replacementHandle = shard.serverPool.handleOf(replacement);
+    auto pending = std::find_if(shard.pendingRightSizes.begin(), shard.pendingRightSizes.end(), [&](const pair<PoolHandle<Server>, PoolHandle<Server>> &entry)
+                                { return entry.first == replacementHandle; });
+    if (pending == shard.pendingRightSizes.end())
+    {
+        return;
+    }
+    Server *retiring = shard.serverPool.get(pending->second);
+    shard.pendingRightSizes.erase(pending);
+    // It no longer replaces anything
+    markSnapshotChange(shard, replacement, snapshotRecordChanged);
+    // The old server may have emptied and closed by itself
+    if (!retiring || retiring->placementSlot == -1)
+    {
+        return;
+    }
+
+    InstanceType instanceType = replacement->getInstanceType();
+    bool fits = replacement->placementSlot != -1 &&
+                replacement->getTotalProcessNum() + retiring->getTotalProcessNum() <= config.capacityOf(instanceType).maxThreshold &&
+                replacement->getUsedVcpuMilli() + retiring->getUsedVcpuMilli() <= Constants::usableVcpuMilli(instanceType) &&
+                replacement->getUsedMemoryMb() + retiring->getUsedMemoryMb() <= Constants::usableMemoryMb(instanceType);
+    if (!fits)
+    {
+        retiring->retiring = false;
+        refreshPlacement(retiring);
+        return;
+    }
+
+    auto processes = retiring->getProcesses();
+    if (processes.empty())
+    {
+        // An empty spare does not close by itself, close it here
+        retiring->elapsed = chrono::duration_cast<chrono::seconds>(clock->now() - retiring->billedUntil).count();
+        closeServer(retiring);
+        retiring->serverStatus = -1;
+        return;
+    }
+    for (const auto &process : processes)
+    {
+        migrateProcess(process, retiring, replacement);
+    }
+}
+
+// Take a server out of the fleet and bill its remaining run time in elapsed.
+// The caller holds the mutex of the server's shard and sets the status to -1 afterwards
+void RegionalAlgo::closeServer(Server *server)
 {
-    regionName = regionNameInput;
-    realTimeReportFile = std::make_shared<std::ofstream>(regionName + "_realTime_log", std::ios::trunc);
-    endOfDayReportFile = std::make_shared<std::ofstream>(regionName + "_endOfDay_log", std::ios::trunc);
-};
+    RegionShard &shard = shardOf(server);
+    markSnapshotChange(shard, server, snapshotRecordChanged);
+    shard.serverBuckets.remove(server);
+    shard.placementEngine.removeServer(server->placementSlot);
+    server->placementSlot = -1;
+    shard.view.remove(server->viewSlot);
+    freeSlots -= server->freeSlotShare;
+    server->freeSlotShare = 0;
+    --serverCount;
+    hourlyCostMicroUsd -= priceMicroUsd(server->getInstanceType());
+    publishSnapshot();
+    if (server->booting)
+    {
+        shard.bootingServers.erase(std::remove(shard.bootingServers.begin(), shard.bootingServers.end(), server), shard.bootingServers.end());
+    }
+    calculateServerCost(shard.totals, server->elapsed, server->getInstanceType());
+    recordEvent(FleetEventKind::ServerClosed, server, server->serverStatus, -1);
+    if (ThreadMetrics *threadMetrics = localMetrics())
+    {
+        threadMetrics->add(MetricCounter::ServersClosed);
+        threadMetrics->transition(server->serverStatus, -1);
+        threadMetrics->record(MetricHistogram::ServerLifetimeMs, chrono::duration_cast<chrono::milliseconds>(clock->now() - server->start).count());
+    }
+    shard.closedServers.push_back(server);
+}
 
-// Continuously listening to requests coming from outside and handling the requests
-void RegionalAlgo::messageReceiver()
+// Give the slots of the closed servers back to the shard's pool. Servers
+// close from inside their own status change, so this only runs once the
+// operation that closed them is over. The caller holds the shard mutex
+void RegionalAlgo::releaseClosedServers(RegionShard &shard)
+{
+    for (Server *server : shard.closedServers)
+    {
+        shard.serverPool.release(shard.serverPool.handleOf(server));
+    }
+    shard.closedServers.clear();
+}
+
+// Print the current server load of the region on demand. The per event
+// history is in the binary event log instead
+void RegionalAlgo::regionalReport()
 {
+    vector<ServerLoad> serversPerStatus[reportStatusCount];
+    for (const ServerView &server : readFleetView(true).servers)
+    {
+        serversPerStatus[server.status].push_back({server.instanceType, server.processCount});
+    }
 
-    auto client = initiateSubClient("subscribe_" + regionName, regionName);
+    // Written at once so the reports of regions printing at the same time do not interleave
+    ostringstream report;
+    report << regionName << " ";
+    writeInfrastructureUpdate(report, serversPerStatus);
+    cout << report.str() << flush;
+}
 
-    bool running = true;
-    while (running)
+FleetViewImage RegionalAlgo::readFleetView(bool withServers)
+{
+    FleetViewImage image;
+    for (auto &shard : shards)
     {
-        // Construct a message pointer to hold an incoming message.
-        mqtt::const_message_ptr messagePointer;
+        shard->view.read(image, withServers);
+    }
+    return image;
+}
+
+int RegionalAlgo::getServerCount()
+{
+    return serverCount.load();
+}
+
+size_t RegionalAlgo::getQueuedRequests()
+{
+    return admissionQueue.size();
+}
 
-        // Try to consume a message, passing messagePointer by reference.
-        // If a message is consumed, the function will return `true`,
-        // allowing control to enter the if-statement body.
-        if (client->try_consume_message(&messagePointer))
+vector<Server *> RegionalAlgo::getServers()
+{
+    vector<Server *> servers;
+    auto locks = lockAllShards();
+    for (auto &shard : shards)
+    {
+        for (int status = 0; status < ServerBuckets::statusCount; ++status)
         {
-            // Construct a string from the message payload.
-            string messageString = messagePointer->get_payload_str();
-            // Print payload string to console (debugging).
+            shard->serverBuckets.forEach(status, [&](Server *server)
+                                         { servers.push_back(server); });
+        }
+    }
+    return servers;
+}
 
-            std::future<void> ft = std::async(std::launch::async, [this]()
-                                              { addProcessToServer(); });
+PlacementPoolStats RegionalAlgo::getPlacementStats()
+{
+    return placementPool.getStats();
+}
 
-            if (messageString == "END OF DAY")
-            {
-                calculateCostBenefitRatio();
-            }
+ShardTotals RegionalAlgo::getLastDayTotals()
+{
+    auto locks = lockAllShards();
+    return lastDayTotals;
+}
 
-            // Perform processing on the string.
-            // This is where message processing can be passed onto different
-            // functions for parsing.
-            // Here, we break the loop and exit the program if a `quit` is received.
-            if (messageString == "quit")
-            {
-                running = false;
-            }
-        }
+static int64_t clockNs(std::chrono::steady_clock::time_point time)
+{
+    return chrono::duration_cast<chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+// List the server among its shard's changes for the next fleet snapshot. The
+// caller holds the shard lock
+void RegionalAlgo::markSnapshotChange(RegionShard &shard, Server *server, int change)
+{
+    if (!snapshotWriter)
+    {
+        return;
     }
+    if (server->snapshotChange == 0)
+    {
+        shard.snapshotChanges.push_back({server->getId(), shard.serverPool.handleOf(server)});
+    }
+    server->snapshotChange |= change;
 }
 
-// As the requests come in adding the processes to servers
-void RegionalAlgo::addProcessToServer()
+// A server change taken from a shard for the snapshot
+struct SnapshotDelta
+{
+    uint32_t id;
+    bool closed;
+    bool withProcesses;
+    CapturedServer server;
+};
+
+void RegionalAlgo::captureFleet(FleetImage &image)
 {
-    // First, get the appropriate server under a smaller lock scope
-    std::shared_ptr<Server> targetServer;
+    image.region = Constants::toIndex(region);
+    image.shards.resize(shards.size());
+    image.changedServers = 0;
+    vector<SnapshotDelta> deltas;
+    for (size_t i = 0; i < shards.size(); ++i)
     {
-        std::lock_guard<std::mutex> lock(serversMutex);
+        RegionShard &shard = *shards[i];
+        ShardImage &shardImage = image.shards[i];
+        deltas.clear();
+        {
+            // Only the changed servers are copied while placement waits
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shardImage.totals = shard.totals;
+            // The day figures only change with every shard locked, any one shard lock is enough to read them
+            if (i == 0)
+            {
+                image.lastDayTotals = lastDayTotals;
+                image.completedDays = completedDays;
+            }
+            deltas.resize(shard.snapshotChanges.size());
+            for (size_t j = 0; j < shard.snapshotChanges.size(); ++j)
+            {
+                SnapshotDelta &delta = deltas[j];
+                delta.id = shard.snapshotChanges[j].first;
+                Server *server = shard.serverPool.get(shard.snapshotChanges[j].second);
+                // A closed server keeps its slot until the operation that closed it is over
+                delta.closed = !server || server->placementSlot == -1;
+                if (delta.closed)
+                {
+                    continue;
+                }
+                delta.withProcesses = server->snapshotChange == snapshotProcessesChanged;
+                server->snapshotChange = 0;
 
-        if (serverStatus0.size() > 0)
+                SnapshotServer &record = delta.server.record;
+                record.id = server->getId();
+                record.replacesId = noServerId;
+                for (const auto &pending : shard.pendingRightSizes)
+                {
+                    Server *retiring = shard.serverPool.get(pending.second);
+                    if (shard.serverPool.get(pending.first) == server && retiring && retiring->placementSlot != -1)
+                    {
+                        record.replacesId = retiring->getId();
+                    }
+                }
+                record.shard = shard.index;
+                record.instanceType = Constants::toIndex(server->getInstanceType());
+                record.status = server->bucketLink.bucket;
+                record.booting = server->booting;
+                record.retiring = server->retiring;
+                record.processCount = server->getTotalProcessNum();
+                record.startNs = clockNs(server->start);
+                record.billedUntilNs = clockNs(server->billedUntil);
+                record.readyAtNs = clockNs(server->readyAt);
+                delta.server.moveOrder = server->bucketLink.moveOrder;
+                delta.server.processes.clear();
+                if (delta.withProcesses)
+                {
+                    server->forEachProcess([&](Process *process)
+                                           {
+                                               SnapshotProcess processRecord{};
+                                               processRecord.startNs = clockNs(process->start);
+                                               processRecord.finishAtNs = clockNs(process->finishAt);
+                                               processRecord.executionTimeMs = process->getExecutionTimeMs();
+                                               processRecord.vCpuMilli = process->getVcpuMilli();
+                                               processRecord.memoryMb = process->getMemoryMb();
+                                               delta.server.processes.push_back(processRecord); });
+                }
+            }
+            shard.snapshotChanges.clear();
+        }
+        if (deltas.empty())
         {
-            targetServer = serverStatus0.front();
+            continue;
         }
-        else if (serverStatus1.size() > 0)
+        image.changedServers += deltas.size();
+
+        for (auto &delta : deltas)
         {
-            targetServer = serverStatus1.front();
+            if (delta.closed)
+            {
+                shardImage.servers.erase(delta.id);
+                continue;
+            }
+            CapturedServer &captured = shardImage.servers[delta.id];
+            captured.record = delta.server.record;
+            captured.moveOrder = delta.server.moveOrder;
+            if (delta.withProcesses)
+            {
+                captured.processes.swap(delta.server.processes);
+            }
         }
-        else if (serverStatus2.size() > 0)
+
+        // Lay the shard out in bucket order, the file is restored in that order
+        vector<const CapturedServer *> ordered;
+        ordered.reserve(shardImage.servers.size());
+        for (const auto &entry : shardImage.servers)
         {
-            targetServer = serverStatus2.front();
+            ordered.push_back(&entry.second);
         }
-        else
+        std::sort(ordered.begin(), ordered.end(), [](const CapturedServer *a, const CapturedServer *b)
+                  { return a->record.status != b->record.status ? a->record.status < b->record.status : a->moveOrder > b->moveOrder; });
+        shardImage.serverRecords.clear();
+        shardImage.processes.clear();
+        for (const CapturedServer *captured : ordered)
         {
-            // Need to add a new server
-            auto newServer = std::make_shared<Server>("c08", [this](std::shared_ptr<Server> serverToChange, int requestedStatus)
-                                                      { changeServerType(serverToChange, requestedStatus); });
-            serverStatus1.insert(serverStatus1.begin(), newServer);
-            ++totalNumOfScaling;
-            targetServer = newServer;
+            shardImage.serverRecords.push_back(captured->record);
+            shardImage.processes.insert(shardImage.processes.end(), captured->processes.begin(), captured->processes.end());
         }
-    } // serversMutex is released here
+    }
+    image.nextServerId = nextServerId.load();
+    image.clockNs = clockNs(clock->now());
+}
 
-    // Now launch the process on the selected server
-    if (targetServer)
+size_t RegionalAlgo::saveFleet()
+{
+    if (!snapshotWriter)
     {
-        targetServer->launchProcess(Constants::averageApplicationExecutionDuration);
-        cout << "PROCESS ADDED\n";
-        ++totalProcesses;
-        // Print out the current server load of the region
-        regionalReport();
+        throw std::logic_error("Fleet snapshots need config.snapshotPrefix");
     }
+    return snapshotWriter->save([this](FleetImage &image)
+                                { captureFleet(image); });
 }
 
-// Adding a new server to the server pool of serverType1 since there is no processes in that server
-void RegionalAlgo::addServer(string instanceTypeInput)
+// A saved time on the clock of this run, shifted by shiftNs
+static std::chrono::steady_clock::time_point restoredTime(int64_t savedNs, int64_t shiftNs)
 {
-    ++totalNumOfScaling;
-    auto server = std::make_shared<Server>(instanceTypeInput, [this](std::shared_ptr<Server> serverToChange, int requestedStatus)
-                                           { changeServerType(serverToChange, requestedStatus); });
-    serverStatus1.insert(serverStatus1.begin(), server);
-};
+    return std::chrono::steady_clock::time_point(chrono::duration_cast<chrono::steady_clock::duration>(chrono::nanoseconds(savedNs + shiftNs)));
+}
 
-// Removing servers that are no more used
-void RegionalAlgo::removeServer()
+void RegionalAlgo::restoreFleet(const string &path)
 {
-    std::lock_guard<std::mutex> lock(serversMutex);
-    // Remove servers with no active processes from the serverType1 vector
-    serverStatus1.erase(
-        std::remove_if(serverStatus1.begin(), serverStatus1.end(),
-                       [](const std::shared_ptr<Server> &server)
-                       {
-                           return server->getTotalProcessNum() == 0;
-                       }),
-        serverStatus1.end());
-};
+    FleetSnapshotReader snapshot(path);
+    const FleetSnapshotHeader &header = snapshot.header();
+    if (header.region != Constants::toIndex(region))
+    {
+        throw std::runtime_error(path + " is a snapshot of " + Constants::regionNames[header.region % Constants::regionCount] + ", not " + regionName);
+    }
+    // Checked up front so the shards can be restored in parallel without failing halfway
+    const SnapshotServer *savedServers = snapshot.servers();
+    vector<size_t> firstProcess(header.serverCount);
+    size_t processTotal = 0;
+    // Each shard fills its own range of the scheduler entries
+    vector<size_t> firstDeadline(shards.size() + 1, 0);
+    for (size_t i = 0; i < header.serverCount; ++i)
+    {
+        const SnapshotServer &saved = savedServers[i];
+        if (saved.instanceType >= Constants::instanceTypeCount || saved.status < 0 || saved.status >= ServerBuckets::statusCount ||
+            saved.processCount > config.capacityOf(static_cast<InstanceType>(saved.instanceType)).absoluteLimit)
+        {
+            throw std::runtime_error("Invalid server " + to_string(saved.id) + " in " + path);
+        }
+        firstProcess[i] = processTotal;
+        processTotal += saved.processCount;
+        firstDeadline[saved.shard % shards.size() + 1] += saved.processCount + (saved.booting ? 1 : 0);
+    }
+    for (size_t i = 1; i < firstDeadline.size(); ++i)
+    {
+        firstDeadline[i] += firstDeadline[i - 1];
+    }
+    if (processTotal != header.processCount)
+    {
+        throw std::runtime_error("Process count mismatch in " + path);
+    }
 
-// Changing server's vector from one type to another depending on its occupancy
-void RegionalAlgo::changeServerType(std::shared_ptr<Server> serverToChange, int requestedStatus)
-{
+    auto locks = lockAllShards();
+    if (serverCount.load() > 0)
+    {
+        throw std::runtime_error("Cannot restore " + path + " into a region that already has servers");
+    }
 
-    std::lock_guard<std::mutex> lock(serversMutex);
+    // Maps a saved time onto this clock. Saved shards may have been captured
+    // before the snapshot was written, their times are on the same clock
+    int64_t downtimeNs = 0;
+    if (!clock->isVirtual())
+    {
+        downtimeNs = std::max<int64_t>(0, chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count() - header.wallClockNs);
+    }
+    int64_t shiftNs = clockNs(clock->now()) - header.clockNs - downtimeNs;
 
-    // Remove server from the original vector it's in
-    auto removeServerFromVector = [&](vector<std::shared_ptr<Server>> &sourceVector)
+    // A snapshot of a different shard count folds its shards onto the ones there are
+    for (size_t i = 0; i < header.shardCount; ++i)
     {
-        auto it = std::remove(sourceVector.begin(), sourceVector.end(), serverToChange);
-        if (it != sourceVector.end())
-        {
-            sourceVector.erase(it);
-        }
-    };
+        shards[i % shards.size()]->totals.add(snapshot.shardTotals()[i]);
+    }
+    lastDayTotals = header.lastDayTotals;
+    completedDays = header.completedDays;
+    nextServerId = header.nextServerId;
 
-    if (serverToChange->serverStatus != requestedStatus)
+    // Every shard has its own pools, so each one fills its servers and
+    // processes on a thread of its own, in the saved order
+    vector<vector<Server *>> restored(shards.size());
+    vector<ScheduledEvent> deadlines(firstDeadline.back());
+    auto restoreShard = [&](size_t shardIndex)
     {
-        if (requestedStatus == -1)
-        {
-            removeServerFromVector(serverStatus0);
-            removeServerFromVector(serverStatus1);
-            removeServerFromVector(serverStatus2);
-            removeServerFromVector(serverStatus3);
-            cout << "SERVER CLOSED\n";
-            calculateServerCost(serverToChange->elapsed, serverToChange->getInstanceType());
-            regionalReport();
-        }
-        if (requestedStatus == 0)
-        {
-            serverStatus0.insert(serverStatus0.begin(), serverToChange);
-            removeServerFromVector(serverStatus1);
-            removeServerFromVector(serverStatus2);
-            removeServerFromVector(serverStatus3);
-        }
-        else if (requestedStatus == 1)
+        RegionShard &shard = *shards[shardIndex];
+        ScheduledEvent *deadline = deadlines.data() + firstDeadline[shardIndex];
+        vector<Process *> serverProcesses;
+        for (size_t i = 0; i < header.serverCount; ++i)
         {
-            serverStatus1.insert(serverStatus1.begin(), serverToChange);
-            removeServerFromVector(serverStatus0);
-            removeServerFromVector(serverStatus2);
-            removeServerFromVector(serverStatus3);
-        }
-        else if (requestedStatus == 2)
-        {
-            serverStatus2.insert(serverStatus2.begin(), serverToChange);
-            removeServerFromVector(serverStatus0);
-            removeServerFromVector(serverStatus1);
-            removeServerFromVector(serverStatus3);
-
-            // If the proccess amount in the server is increasing then create a new server with increased resource configuration (vertical scaling)
-            // and if the server resource is at maximum possible than create an identical server
-            if (serverToChange->serverStatus < requestedStatus && serverStatus1.empty())
+            const SnapshotServer &saved = savedServers[i];
+            if (saved.shard % shards.size() != shardIndex)
             {
-                auto nextTypeOpt = Constants::getNextInstanceType(serverToChange->getInstanceType());
-                if (nextTypeOpt)
-                {
-                    cout << serverToChange->getInstanceType();
-                    cout << *nextTypeOpt;
-                    // Optional has a value, so use it
-                    addServer(*nextTypeOpt);
-                }
-                else
-                {
-                    addServer(serverToChange->getInstanceType());
-                }
+                continue;
+            }
+            InstanceType instanceType = static_cast<InstanceType>(saved.instanceType);
+            PoolHandle<Server> handle = shard.serverPool.acquire(saved.id, shard.index, instanceType, config.capacityOf(instanceType), clock.get(), this);
+            Server *server = shard.serverPool.get(handle);
+            server->serverStatus = saved.status;
+            server->start = restoredTime(saved.startNs, shiftNs);
+            server->billedUntil = restoredTime(saved.billedUntilNs, shiftNs);
+            server->readyAt = restoredTime(saved.readyAtNs, shiftNs);
+            server->booting = saved.booting;
+            server->retiring = saved.retiring;
+            serverProcesses.clear();
+            const SnapshotProcess *savedProcess = snapshot.processes() + firstProcess[i];
+            for (int j = 0; j < saved.processCount; ++j, ++savedProcess)
+            {
+                PoolHandle<Process> processHandle = shard.processPool.acquire(savedProcess->executionTimeMs, savedProcess->vCpuMilli, savedProcess->memoryMb);
+                Process *process = shard.processPool.get(processHandle);
+                process->start = restoredTime(savedProcess->startNs, shiftNs);
+                process->finishAt = restoredTime(savedProcess->finishAtNs, shiftNs);
+                serverProcesses.push_back(process);
+                *deadline++ = {process->finishAt, 0, ScheduledEventKind::ProcessCompletion, shard.index, {}, processHandle};
+            }
+            server->restoreProcesses(serverProcesses);
+            if (server->booting)
+            {
+                shard.bootingServers.push_back(server);
+                *deadline++ = {server->readyAt, 0, ScheduledEventKind::ServerReady, shard.index, handle, {}};
             }
+            restored[shardIndex].push_back(server);
+        }
+    };
+    if (shards.size() == 1)
+    {
+        restoreShard(0);
+    }
+    else
+    {
+        vector<thread> workers;
+        for (size_t i = 0; i < shards.size(); ++i)
+        {
+            workers.emplace_back(restoreShard, i);
         }
-        else if (requestedStatus == 3)
+        for (auto &worker : workers)
         {
-            serverStatus3.insert(serverStatus3.begin(), serverToChange);
-            removeServerFromVector(serverStatus0);
-            removeServerFromVector(serverStatus1);
-            removeServerFromVector(serverStatus2);
+            worker.join();
         }
     }
-};
-
-void RegionalAlgo::regionalReport()
-{
-    // Use a stringstream to construct the message
-    std::stringstream reportStream;
 
-    // Add to both the reportStream and console output
-    reportStream << "Infrastructure update:\n";
-    reportStream << "---------------------------\n";
-    reportStream << "Total Number of Server Type 0: " << serverStatus0.size() << "\n";
-    reportStream << "Total Number of Server Type 1: " << serverStatus1.size() << "\n";
-    reportStream << "Total Number of Server Type 2: " << serverStatus2.size() << "\n";
-    reportStream << "Total Number of Server Type 3: " << serverStatus3.size() << "\n";
-    reportStream << "---------------------------\n";
-
-    // Print individual server details for each status type
-    if (!serverStatus0.empty())
+    unordered_map<uint32_t, Server *> serversById;
+    serversById.reserve(header.serverCount);
+    for (size_t i = 0; i < shards.size(); ++i)
     {
-        reportStream << "Individual Server Type 0 Process Numbers:\n";
-        for (const auto &server : serverStatus0)
+        RegionShard &shard = *shards[i];
+        // Buckets take servers at the front, so going backwards keeps their saved order
+        for (auto server = restored[i].rbegin(); server != restored[i].rend(); ++server)
         {
-            reportStream << server->getInstanceType() << ":" << server->getTotalProcessNum() << "/";
+            shard.serverBuckets.moveToFront((*server)->serverStatus, *server);
         }
-        reportStream << "\n";
-    }
-    if (!serverStatus1.empty())
-    {
-        reportStream << "Individual Server Type 1 Process Numbers:\n";
-        for (const auto &server : serverStatus1)
+        for (Server *server : restored[i])
         {
-            reportStream << server->getInstanceType() << ":" << server->getTotalProcessNum() << "/";
+            InstanceType instanceType = server->getInstanceType();
+            server->placementSlot = shard.placementEngine.addServer(server, Constants::usableVcpuMilli(instanceType), Constants::usableMemoryMb(instanceType));
+            serversById[server->getId()] = server;
+            runningProcesses += server->getTotalProcessNum();
+            ++serverCount;
+            hourlyCostMicroUsd += priceMicroUsd(instanceType);
         }
-        reportStream << "\n";
+        std::sort(shard.bootingServers.begin(), shard.bootingServers.end(), [](Server *a, Server *b)
+                  { return a->readyAt < b->readyAt; });
     }
-    if (!serverStatus2.empty())
+    processScheduler.scheduleAll(std::move(deadlines));
+
+    // Pair the booting replacements with the servers they replace again. A
+    // retiring server whose replacement is gone goes back into service
+    for (size_t i = 0; i < header.serverCount; ++i)
     {
-        reportStream << "Individual Server Type 2 Process Numbers:\n";
-        for (const auto &server : serverStatus2)
+        const SnapshotServer &saved = savedServers[i];
+        auto replacement = serversById.find(saved.id);
+        auto replaced = serversById.find(saved.replacesId);
+        if (saved.replacesId != noServerId && replacement != serversById.end() && replaced != serversById.end() &&
+            replacement->second->getShardIndex() == replaced->second->getShardIndex())
         {
-            reportStream << server->getInstanceType() << ":" << server->getTotalProcessNum() << "/";
+            RegionShard &shard = shardOf(replacement->second);
+            shard.pendingRightSizes.push_back({shard.serverPool.handleOf(replacement->second), shard.serverPool.handleOf(replaced->second)});
         }
-        reportStream << "\n";
     }
-    if (!serverStatus3.empty())
+    for (auto &shard : shards)
     {
-        reportStream << "Individual Server Type 3 Process Numbers:\n";
-        for (const auto &server : serverStatus3)
+        for (Server *server : restored[shard->index])
         {
-            reportStream << server->getInstanceType() << ":" << server->getTotalProcessNum() << "/";
+            if (server->retiring)
+            {
+                PoolHandle<Server> handle = shard->serverPool.handleOf(server);
+                server->retiring = std::any_of(shard->pendingRightSizes.begin(), shard->pendingRightSizes.end(), [&](const pair<PoolHandle<Server>, PoolHandle<Server>> &entry)
+                                               { return entry.second == handle; });
+            }
+            refreshPlacement(server);
         }
-        reportStream << "\n";
     }
+}
 
-    reportStream << "---------------------------\n\n";
+MetricsSnapshot RegionalAlgo::getMetrics()
+{
+    MetricsSnapshot snapshot = metrics.snapshot();
+    snapshot.queueWaitNs = placementPool.getWaitHistogram();
+    return snapshot;
+}
 
-    // Output to console
-    std::cout << reportStream.str();
+// Block of the calling thread, or nullptr when the region collects no metrics
+ThreadMetrics *RegionalAlgo::localMetrics()
+{
+    return config.collectMetrics ? &metrics.local() : nullptr;
+}
 
-    // Output to file if it's open
-    if (realTimeReportFile->is_open())
-    {
-        *realTimeReportFile << reportStream.str();
-        realTimeReportFile->flush(); // Ensure the data is written to the file
-    }
+// The current metrics as one exported line, stamped with the region's clock
+string RegionalAlgo::metricsLine()
+{
+    ostringstream line;
+    writeMetricsJson(line, regionName, chrono::duration<double>(clock->now().time_since_epoch()).count(), getMetrics(), readFleetView(false));
+    return line.str();
 }
 
-void RegionalAlgo::calculateServerCost(float runTime, string instanceType)
+void RegionalAlgo::calculateServerCost(ShardTotals &totals, float runTime, InstanceType instanceType)
 {
     // The server pricing is USD/hour thats why we first find the server runTime in seconds
     // for real life than convert that time to hours and finally multiply with how much that
     // server costs in the region
-    float realLifeRunTime = (runTime * 200) / 3600;
-    totalServerCost += realLifeRunTime * Constants::overallServerPricing.find(regionName)->second.find(instanceType)->second;
+    float realLifeRunTime = (runTime * Constants::timeCompressionFactor) / 3600;
+    float cost = realLifeRunTime * Constants::priceOf(region, instanceType);
+    totals.serverCost += cost;
+    totals.costPerInstanceType[Constants::toIndex(instanceType)] += cost;
+}
+
+// Returning the deadline of the next scheduled event, false if none is pending
+bool RegionalAlgo::nextEventDeadline(std::chrono::steady_clock::time_point &deadline)
+{
+    return processScheduler.nextDeadline(deadline);
+}
+
+// Dispatch every scheduled event whose deadline is at or before the current clock time
+void RegionalAlgo::dispatchDueEvents()
+{
+    processScheduler.dispatchDue(clock->now());
+}
+
+// Servers are billed when they close. Bill the ones that are still running up
+// to now as well, so each day carries the cost of the servers it kept open and
+// a policy cannot look cheap by never letting a server empty out. The caller
+// holds every shard mutex
+void RegionalAlgo::billRunningServers()
+{
+    auto now = clock->now();
+    for (auto &shard : shards)
+    {
+        for (int status = 0; status < ServerBuckets::statusCount; ++status)
+        {
+            shard->serverBuckets.forEach(status, [&](Server *server)
+                                         {
+                                             long runTime = chrono::duration_cast<chrono::seconds>(now - server->billedUntil).count();
+                                             calculateServerCost(shard->totals, runTime, server->getInstanceType());
+                                             server->billedUntil += chrono::seconds(runTime);
+                                             markSnapshotChange(*shard, server, snapshotRecordChanged); });
+        }
+    }
 }
 
 void RegionalAlgo::calculateCostBenefitRatio()
@@ -285,150 +1906,282 @@ void RegionalAlgo::calculateCostBenefitRatio()
     // in order to discourage the unnecesarry scale up, in the calculation
     // it is taken as one of the cost factors
 
+    auto locks = lockAllShards();
+    billRunningServers();
+
+    // Each shard keeps its own figures, the report is about the whole region
+    ShardTotals totals;
+    for (auto &shard : shards)
+    {
+        totals.add(shard->totals);
+    }
+
     // Use a stringstream to construct the message
     std::stringstream reportStream;
 
     // Add to both the reportStream and console output
     reportStream << "-------END OF DAY REPORT-------\n";
-    reportStream << "Total proccesses that was sent to the server network: " << totalProcesses << endl;
-    reportStream << "Total cost to run the server network: " << totalServerCost << "$" << endl;
-    reportStream << "Overall time spent on server holdup between scaling and initial boots: " << totalNumOfScaling * Constants::averageServerBootDuration << " seconds"<< endl;
-    reportStream << "Maximum vertical availability of the infrastructure: " << Constants::processCapacityPerInstanceType.at("c88").absoluteLimit << endl;
+    reportStream << "Total proccesses that was sent to the server network: " << totals.processes << endl;
+    reportStream << "Total cost to run the server network: " << totals.serverCost << "$" << endl;
+    reportStream << "Cost per instance type:";
+    for (int i = 0; i < Constants::instanceTypeCount; ++i)
+    {
+        reportStream << " " << Constants::instanceTypeName(static_cast<InstanceType>(i)) << " " << totals.costPerInstanceType[i] << "$";
+    }
+    reportStream << endl;
+    reportStream << "Overall time spent on server holdup between scaling and initial boots: " << totals.scalings * Constants::averageServerBootDuration << " seconds"<< endl;
+    reportStream << "Maximum vertical availability of the infrastructure: " << config.capacityOf(Constants::largestInstanceType).absoluteLimit << endl;
+    if (config.modelServerBoot)
+    {
+        reportStream << "Measured time processes waited for booting servers: " << totals.processHoldup << " seconds" << endl;
+    }
+    if (config.predictiveScaling)
+    {
+        reportStream << "Servers launched ahead of forecast demand: " << totals.prewarmedServers << endl;
+    }
+    if (coordinator)
+    {
+        reportStream << "Requests spilled to other regions: " << totals.spilledOut << " (average latency penalty "
+                     << (totals.spilledOut > 0 ? totals.spillLatencyMs / totals.spilledOut : 0) << " ms)" << endl;
+        reportStream << "Requests taken over from other regions: " << totals.spilledIn << endl;
+    }
+    if (config.rightSizing)
+    {
+        reportStream << "Servers replaced by a cheaper instance type: " << totals.rightSizes << endl;
+    }
+    if (config.consolidation)
+    {
+        reportStream << "Processes migrated off underloaded servers: " << totals.migrations << " (" << totals.migrationPause << " seconds of migration pauses)" << endl;
+    }
+    if (config.maxServers > 0 || config.maxCostPerHour > 0)
+    {
+        reportStream << "Requests that waited for the fleet limits: " << totals.queuedRequests << " (average wait "
+                     << (totals.queuedRequests > 0 ? totals.queueWaitSeconds / totals.queuedRequests : 0) << " seconds, longest "
+                     << totals.longestQueueWaitSeconds << " seconds), still waiting: " << admissionQueue.size() << endl;
+        reportStream << "Requests rejected because the admission queue was full:";
+        for (int i = 0; i < requestPriorityCount; ++i)
+        {
+            reportStream << " " << requestPriorityNames[i] << " " << totals.rejectedRequests[i];
+        }
+        reportStream << endl;
+        reportStream << "Requests dropped after their deadline passed:";
+        for (int i = 0; i < requestPriorityCount; ++i)
+        {
+            reportStream << " " << requestPriorityNames[i] << " " << totals.expiredRequests[i];
+        }
+        reportStream << endl;
+    }
+    if (completedDays < (int)config.dailyCostLowerBounds.size())
+    {
+        double lowerBound = config.dailyCostLowerBounds[completedDays];
+        reportStream << "Offline lower bound on the cost: " << lowerBound << "$ (competitive ratio "
+                     << (lowerBound > 0 ? totals.serverCost / lowerBound : 0) << ")" << endl;
+    }
     reportStream << "-------END OF DAY REPORT-------\n";
 
     // Output to console
     std::cout << reportStream.str();
 
+    // Placement queue figures are only meaningful for the real-time path, so
+    // they go to the console and not into the report that the simulation reproduces
+    PlacementPoolStats poolStats = placementPool.getStats();
+    if (poolStats.placed > 0)
+    {
+        std::cout << "Placement queue: " << poolStats.placed << " placed, depth " << poolStats.queueDepth
+                  << " (max " << poolStats.maxQueueDepth << "), wait avg " << poolStats.averageWaitMs
+                  << " ms, p50 " << poolStats.p50WaitMs << " ms, p99 " << poolStats.p99WaitMs
+                  << " ms, max " << poolStats.maxWaitMs << " ms" << endl;
+    }
+    if (malformedRequests.load() > 0)
+    {
+        std::cout << "Malformed requests skipped so far: " << malformedRequests.load() << endl;
+    }
+    if (eventLog.getDroppedCount() > 0)
+    {
+        std::cout << "Event log: " << eventLog.getDroppedCount() << " events dropped because the writer fell behind" << endl;
+    }
+
     // Output to file if it's open
     if (endOfDayReportFile->is_open())
     {
         *endOfDayReportFile << reportStream.str();
         endOfDayReportFile->flush(); // Ensure the data is written to the file
     }
-    totalNumOfScaling = 0;
-    totalProcesses = 0;
-    totalServerCost = 0;
+    lastDayTotals = totals;
+    ++completedDays;
+    for (auto &shard : shards)
+    {
+        shard->totals = ShardTotals();
+    }
+    demandForecaster.beginDay();
+    // Simulated days pass faster than any export interval
+    if (metricsExporter)
+    {
+        metricsExporter->write(metricsLine());
+    }
+    // Same for snapshots. Capturing takes the shard locks one at a time
+    if (snapshotWriter && clock->isVirtual())
+    {
+        locks.clear();
+        try
+        {
+            saveFleet();
+        }
+        catch (const std::exception &error)
+        {
+            cerr << error.what() << endl;
+        }
+    }
 }
 
 //////////////////
 // Process class implementation
-Process::Process(int executionTimeInput, function<void(std::shared_ptr<Process>)> onComplete)
+// A process only records how long it runs, its completion is driven by the
+// regional process scheduler instead of a thread of its own
+Process::Process(int executionTimeMsInput, int vCpuMilliInput, int memoryMbInput)
 {
-    executionTime = executionTimeInput;
-    onCompleteCallback = onComplete;
-    start();
+    executionTimeMs = executionTimeMsInput;
+    vCpuMilli = vCpuMilliInput;
+    memoryMb = memoryMbInput;
+    host = nullptr;
 };
 
-Process::~Process()
+// Return the simulated execution time of the process in milliseconds
+int Process::getExecutionTimeMs()
 {
-    if (processThread.joinable())
-    {
-        if (processThread.get_id() == std::this_thread::get_id())
-        {
-            // Avoid joining the thread if it's the same as the current thread
-            processThread.detach();
-        }
-        else
-        {
-            processThread.join();
-        }
-    }
+    return executionTimeMs;
 }
 
-// Create a seperate thread that will simulate a running application
-void Process::start()
+// Return the vCPU demand of the process in thousandths of a vCPU
+int Process::getVcpuMilli()
 {
-    processThread = thread(&Process::run, this);
+    return vCpuMilli;
 }
 
-// Running the simulated application and when it ends destroying the thread
-void Process::run()
+// Return the memory demand of the process in MB
+int Process::getMemoryMb()
 {
-    std::this_thread::sleep_for(std::chrono::seconds(executionTime));
-
-    std::function<void(std::shared_ptr<Process>)> callback;
-    {
-        std::lock_guard<std::mutex> lock(callbackMutex);
-        if (onCompleteCallback)
-        {
-            callback = onCompleteCallback; // Make a local copy
-        }
-    }
-
-    if (callback)
-    {
-        auto self = shared_from_this(); // Keep Process alive during callback
-        callback(self);                 // Use the local copy
-    }
+    return memoryMb;
 }
 
 //////////////////
 // Server class implementation
-Server::Server(string instanceTypeInput, function<void(std::shared_ptr<Server> serverToChange, int requestedStatus)> serverStatusChangeSignal)
+Server::Server(uint32_t idInput, int shardIndexInput, InstanceType instanceTypeInput, const Capacity &capacityInput, SimClock *clockInput, ServerStatusListener *statusListenerInput)
 {
-    serverStatusChangeSignalCallback = serverStatusChangeSignal;
+    statusListener = statusListenerInput;
+    id = idInput;
+    shardIndex = shardIndexInput;
     instanceType = instanceTypeInput;
+    capacity = capacityInput;
+    activeProcesses.reserve(capacity.absoluteLimit);
+    activeProcessCount = 0;
+    usedVcpuMilli = 0;
+    usedMemoryMb = 0;
+    placementSlot = -1;
+    viewSlot = -1;
+    clock = clockInput;
     serverStatus = 1;
-    start = chrono::steady_clock::now();
+    start = clock->now();
+    billedUntil = start;
+    readyAt = start;
+    booting = false;
+    retiring = false;
+    freeSlotShare = 0;
+    snapshotChange = 0;
 };
 
-// Adds new processes to the server
-void Server::launchProcess(int executionTime)
+// Adds new processes to the server, the caller schedules its completion.
+// On a server that is still booting the process starts once the boot is over
+void Server::launchProcess(Process *newProcess)
+{
+    std::lock_guard<std::mutex> lock(processesMutex);
+    newProcess->start = std::max(clock->now(), readyAt);
+    attachProcessLocked(newProcess);
+}
+
+// Adds a process that was running on another server, the caller reschedules its completion
+void Server::adoptProcess(Process *migratedProcess)
+{
+    std::lock_guard<std::mutex> lock(processesMutex);
+    attachProcessLocked(migratedProcess);
+}
+
+void Server::restoreProcesses(const vector<Process *> &restoredProcesses)
 {
     std::lock_guard<std::mutex> lock(processesMutex);
-    std::shared_ptr<Process> newProcess = std::make_shared<Process>(executionTime, [this](std::shared_ptr<Process> completedProcess)
-                                                                    { removeProcess(completedProcess); });
-    activeProcesses.push_back(newProcess);
+    for (const auto &process : restoredProcesses)
+    {
+        linkProcessLocked(process);
+    }
+}
+
+// The caller holds processesMutex
+void Server::attachProcessLocked(Process *process)
+{
+    linkProcessLocked(process);
     changeStatus();
 }
 
+// The caller holds processesMutex
+void Server::linkProcessLocked(Process *process)
+{
+    process->host = this;
+    activeProcesses.push_back(process);
+    activeProcessCount = activeProcesses.size();
+    usedVcpuMilli += process->getVcpuMilli();
+    usedMemoryMb += process->getMemoryMb();
+}
+
+// Returning a copy of the running processes
+vector<Process *> Server::getProcesses()
+{
+    std::lock_guard<std::mutex> lock(processesMutex);
+    return activeProcesses;
+}
+
 // Send a callback to the algorithm for updating server status according to active process num
 void Server::changeStatus()
 {
-    if (activeProcesses.size() == 0)
+    int processCount = activeProcesses.size();
+    if (processCount == 0)
     {
-        if (serverStatusChangeSignalCallback)
+        if (statusListener)
         {
-            auto now = chrono::steady_clock::now();
-            elapsed = chrono::duration_cast<chrono::seconds>(now - start).count();
-            auto self = shared_from_this();             // Keep Process alive during callback
-            serverStatusChangeSignalCallback(self, -1); // Use the local copy
+            auto now = clock->now();
+            elapsed = chrono::duration_cast<chrono::seconds>(now - billedUntil).count();
+            statusListener->changeServerType(this, -1);
             serverStatus = -1;
         }
     }
-    else if (activeProcesses.size() <= Constants::processCapacityPerInstanceType.at(instanceType).minThreshold)
+    else if (processCount <= capacity.minThreshold)
     {
-        if (serverStatusChangeSignalCallback)
+        if (statusListener)
         {
-            auto self = shared_from_this();            // Keep Process alive during callback
-            serverStatusChangeSignalCallback(self, 1); // Use the local copy
+            statusListener->changeServerType(this, 1);
             serverStatus = 1;
         }
     }
-    else if (activeProcesses.size() <= Constants::processCapacityPerInstanceType.at(instanceType).maxThreshold)
+    else if (processCount <= capacity.maxThreshold)
     {
-        if (serverStatusChangeSignalCallback)
+        if (statusListener)
         {
-            auto self = shared_from_this();            // Keep Process alive during callback
-            serverStatusChangeSignalCallback(self, 0); // Use the local copy
+            statusListener->changeServerType(this, 0);
             serverStatus = 0;
         }
     }
-    else if (activeProcesses.size() < Constants::processCapacityPerInstanceType.at(instanceType).absoluteLimit)
+    else if (processCount < capacity.absoluteLimit)
     {
-        if (serverStatusChangeSignalCallback)
+        if (statusListener)
         {
-            auto self = shared_from_this();            // Keep Process alive during callback
-            serverStatusChangeSignalCallback(self, 2); // Use the local copy
+            statusListener->changeServerType(this, 2);
             serverStatus = 2;
         }
     }
-    else if (activeProcesses.size() == Constants::processCapacityPerInstanceType.at(instanceType).absoluteLimit)
+    else if (processCount == capacity.absoluteLimit)
     {
-        if (serverStatusChangeSignalCallback)
+        if (statusListener)
         {
-            auto self = shared_from_this();            // Keep Process alive during callback
-            serverStatusChangeSignalCallback(self, 3); // Use the local copy
+            statusListener->changeServerType(this, 3);
             serverStatus = 3;
         }
     }
@@ -438,8 +2191,8 @@ void Server::changeStatus()
     }
 };
 
-// Removing processes that are executed (This is used as a callback and given to Process class to handle its own lifecycle)
-void Server::removeProcess(std::shared_ptr<Process> completedProcess)
+// Removing processes that are executed (This is called by the regional process scheduler once the process deadline passes)
+void Server::removeProcess(Process *completedProcess)
 {
     // Then remove from active processes
     std::lock_guard<std::mutex> lock(processesMutex);
@@ -447,20 +2200,45 @@ void Server::removeProcess(std::shared_ptr<Process> completedProcess)
     if (it != activeProcesses.end())
     {
         activeProcesses.erase(it);
+        usedVcpuMilli -= completedProcess->getVcpuMilli();
+        usedMemoryMb -= completedProcess->getMemoryMb();
     }
+    activeProcessCount = activeProcesses.size();
     changeStatus();
-    cout << "PROCESS REMOVED\n";
 }
 
 // Returning the total amount of processes runnning simultaniously
 int Server::getTotalProcessNum()
 {
-    std::lock_guard<std::mutex> lock(processesMutex);
-    return activeProcesses.size();
+    return activeProcessCount.load();
+}
+
+// Returning the vCPU demand of the running processes in thousandths of a vCPU
+int Server::getUsedVcpuMilli()
+{
+    return usedVcpuMilli.load();
+}
+
+// Returning the memory demand of the running processes in MB
+int Server::getUsedMemoryMb()
+{
+    return usedMemoryMb.load();
+}
+
+// Return the region-unique id of the server
+uint32_t Server::getId()
+{
+    return id;
+}
+
+// Return the index of the region shard the server belongs to
+int Server::getShardIndex()
+{
+    return shardIndex;
 }
 
 // Return the instance type of the server
-string Server::getInstanceType()
+InstanceType Server::getInstanceType()
 {
     return instanceType;
 }
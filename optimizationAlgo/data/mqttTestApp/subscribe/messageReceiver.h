@@ -6,73 +6,281 @@
 #include <fstream>
 #include <functional>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include "../common/transport.h"
+#include "admissionQueue.h"
+#include "appConst.h"
+#include "demandForecaster.h"
+#include "eventLog.h"
+#include "fleetSnapshot.h"
+#include "globalCoordinator.h"
+#include "placementPool.h"
+#include "processScheduler.h"
+#include "regionConfig.h"
+#include "regionMetrics.h"
+#include "regionShard.h"
+#include "serverBuckets.h"
+#include "simClock.h"
 using namespace std;
 
-class Process : public std::enable_shared_from_this<Process>
+class Server;
+
+// Lives in the process pool of a region shard, from launch until completion
+class Process
 {
 public:
-    Process(int executionTimeInput, function<void(std::shared_ptr<Process>)> onComplete);
-    ~Process();
-    void start();
-    void run();
-    thread processThread;
+    Process(int executionTimeMsInput, int vCpuMilliInput, int memoryMbInput);
+    int getExecutionTimeMs();
+    int getVcpuMilli();
+    int getMemoryMb();
+    std::chrono::steady_clock::time_point start;
+    // When the process completes, moved back by the pause of every migration
+    std::chrono::steady_clock::time_point finishAt;
+    // Server the process currently runs on
+    Server *host;
 
 private:
-    int executionTime;
-    function<void(std::shared_ptr<Process> completedProces)> onCompleteCallback;
-    std::mutex mutex_;
-    std::mutex callbackMutex;
+    int executionTimeMs;
+    int vCpuMilli;
+    int memoryMb;
 };
 
-class Server : public std::enable_shared_from_this<Server>
+// Told about every status change of a server, implemented by the region that owns it
+class ServerStatusListener
 {
 public:
-    Server(string instanceTypeInput, function<void(std::shared_ptr<Server> serverToChange, int requestedStatus)> serverStatusChangeSignal);
-    void launchProcess(int executionTime);
-    void removeProcess(std::shared_ptr<Process> completedProcess);
+    virtual void changeServerType(Server *serverToChange, int requestedStatus) = 0;
+
+protected:
+    ~ServerStatusListener() = default;
+};
+
+// Lives in the server pool of a region shard, from launch until it closes
+class Server
+{
+public:
+    Server(uint32_t idInput, int shardIndexInput, Constants::InstanceType instanceTypeInput, const Constants::Capacity &capacityInput, SimClock *clockInput, ServerStatusListener *statusListenerInput);
+    void launchProcess(Process *newProcess);
+    void removeProcess(Process *completedProcess);
+    // Takes over a running process that was removed from another server
+    void adoptProcess(Process *migratedProcess);
+    // Takes back the processes of a fleet snapshot. The status is restored by
+    // the region, so this never triggers a scale up
+    void restoreProcesses(const vector<Process *> &restoredProcesses);
+    vector<Process *> getProcesses();
+    // Calls visit for every running process without copying the list
+    template <typename Visitor>
+    void forEachProcess(Visitor visit)
+    {
+        std::lock_guard<std::mutex> lock(processesMutex);
+        for (const auto &process : activeProcesses)
+        {
+            visit(process);
+        }
+    }
     void changeStatus();
     int getTotalProcessNum();
-    string getInstanceType();
+    int getUsedVcpuMilli();
+    int getUsedMemoryMb();
+    Constants::InstanceType getInstanceType();
+    uint32_t getId();
+    int getShardIndex();
     int serverStatus;
     std::chrono::steady_clock::time_point start;
+    // Run time up to here has already been added to the region's cost
+    std::chrono::steady_clock::time_point billedUntil;
     long elapsed;
+    // Position in the region's status buckets, maintained by ServerBuckets
+    BucketLink bucketLink;
+    // Slot of the server in the region's placement engine
+    int placementSlot;
+    // Slot of the server in its shard's fleet view
+    int viewSlot;
+    // Processes launched before this time wait for the server to finish booting
+    std::chrono::steady_clock::time_point readyAt;
+    bool booting;
+    // Waiting for a cheaper replacement to boot, takes no new processes
+    bool retiring;
+    // Free process slots this server adds to the region's published snapshot
+    int freeSlotShare;
+    // What changed since the last fleet snapshot took its shard's changes,
+    // see RegionalAlgo::markSnapshotChange
+    int snapshotChange;
 
 private:
-    function<void(std::shared_ptr<Server> serverToChange, int requestedStatus)> serverStatusChangeSignalCallback;
+    void attachProcessLocked(Process *process);
+    void linkProcessLocked(Process *process);
+
+    ServerStatusListener *statusListener;
+    SimClock *clock;
     std::mutex processesMutex;
-    string instanceType;
-    vector<std::shared_ptr<Process>> activeProcesses;
+    uint32_t id;
+    int shardIndex;
+    Constants::InstanceType instanceType;
+    // Process counts of the status thresholds, from the region's config
+    Constants::Capacity capacity;
+    // Reserved up to the absolute limit, so it never allocates after construction
+    vector<Process *> activeProcesses;
+    // Mirrors activeProcesses.size() so it can be read without processesMutex,
+    // including from inside the status change callback
+    atomic<int> activeProcessCount;
+    // Sum of the demand of the active processes
+    atomic<int> usedVcpuMilli;
+    atomic<int> usedMemoryMb;
 };
 
-class RegionalAlgo
+class RegionalAlgo : public ServerStatusListener
 {
 public:
-    RegionalAlgo(string regionNameInput);
+    RegionalAlgo(string regionNameInput, RegionConfig configInput = RegionConfig(), std::shared_ptr<SimClock> clockInput = std::make_shared<RealClock>());
+    ~RegionalAlgo();
     string regionName;
-    void messageReceiver();
-    void addProcessToServer();
-    void addServer(string instanceTypeInput);
+    Constants::Region region;
+    // Receives the region's requests through the transport until a quit message
+    void messageReceiver(Transport &transport);
+    void addProcessToServer(const RequestMessage &request);
+    // Joins the coordinator so this region can take over and hand off
+    // requests, every region joins before traffic starts
+    void attachCoordinator(GlobalCoordinator *coordinatorInput);
+    // Places a request that another region handed over on a server that has
+    // room, never spills it again. Returns false without scaling up if no
+    // server has room any more, the sender then places it itself
+    bool addSpilledRequest(const RequestMessage &request);
+    void placeRequests(vector<PlacementRequest> &batch);
+    void completeProcess(int shardIndex, PoolHandle<Process> completedProcess);
+    void addServer(RegionShard &shard, Constants::InstanceType instanceTypeInput);
     void removeServer();
-    void changeServerType(std::shared_ptr<Server> serverToChange, int requestedType);
+    void changeServerType(Server *serverToChange, int requestedType) override;
     void calculateCostBenefitRatio();
-    void calculateServerCost(float runTime, string instanceType);
+    void calculateServerCost(ShardTotals &totals, float runTime, Constants::InstanceType instanceType);
+    void billRunningServers();
+    // Prints the servers of each status from the fleet view, without taking a placement lock
     void regionalReport();
+    // Counts per status, load per instance type and, with withServers, the
+    // process count of every server. Each shard's figures are from one moment
+    // and no placement lock is taken, so it may run as often as wanted
+    FleetViewImage readFleetView(bool withServers);
+    int getServerCount();
+    // Requests waiting in the admission queue for the fleet limits
+    size_t getQueuedRequests();
+    // Every server of the region, for tools and benchmarks. The pointers are
+    // only valid until the fleet changes
+    vector<Server *> getServers();
+    PlacementPoolStats getPlacementStats();
+    // Figures of the last day that ended, the same as its end of day report
+    ShardTotals getLastDayTotals();
+    // Counters and latency histograms of every thread working for the region
+    MetricsSnapshot getMetrics();
+    void flushEventLog();
+    // Brings the image up to date one shard lock at a time. Only the servers
+    // that changed since the image was last filled are copied under the lock,
+    // so the image must be the one every earlier capture filled
+    void captureFleet(FleetImage &image);
+    // Writes the snapshot file of config.snapshotPrefix now, returns its size in bytes
+    size_t saveFleet();
+    // Starts from the servers, processes and totals of a snapshot instead of an
+    // empty fleet. Servers and processes kept running while nothing watched
+    // them, so the saved times are aged by the wall clock time since the
+    // snapshot and processes that finished meanwhile complete right away.
+    // Only valid before the region receives requests, throws
+    // std::runtime_error for a bad file or a region that already has servers
+    void restoreFleet(const string &path);
+    // Discrete-event simulation hooks, only used when running on a virtual clock
+    bool nextEventDeadline(std::chrono::steady_clock::time_point &deadline);
+    void dispatchDueEvents();
 
 private:
-    float totalServerCost;
-    float totalProcesses;
-    int totalNumOfScaling;
-    std::shared_ptr<std::ofstream> realTimeReportFile;
+    RegionShard &acquireShard(std::unique_lock<std::mutex> &lock);
+    vector<std::unique_lock<std::mutex>> lockAllShards();
+    RegionShard &shardOf(Server *server);
+    RegionShard &leastLoadedShard();
+    bool placeRequestLocked(RegionShard &shard, const RequestMessage &request, bool allowSpill);
+    bool placeOnExistingServer(RegionShard &shard, const RequestMessage &request);
+    bool stealPlacement(RegionShard &homeShard, const RequestMessage &request);
+    void launchRequest(RegionShard &shard, Server *targetServer, const RequestMessage &request);
+    void spillOrPlace(const RequestMessage &request);
+    void publishSnapshot();
+    Server *selectServer(RegionShard &shard, const RequestMessage &request);
+    Server *selectServerByStatus(RegionShard &shard);
+    Server *selectBootingServer(RegionShard &shard, const RequestMessage &request);
+    void handleScheduledEvent(const ScheduledEvent &event);
+    void markServerReady(int shardIndex, PoolHandle<Server> server);
+    void maintenanceTick(std::chrono::steady_clock::time_point tickTime);
+    void scaleToForecast();
+    void consolidationTick(std::chrono::steady_clock::time_point tickTime);
+    void consolidateServers();
+    void migrateProcess(Process *process, Server *source, Server *destination);
+    void rightSizingTick(std::chrono::steady_clock::time_point tickTime);
+    void rightSizeServers();
+    std::optional<Constants::InstanceType> cheapestTypeFor(Server *server);
+    void finishRightSizing(Server *replacement);
+    void closeServer(Server *server);
+    void releaseClosedServers(RegionShard &shard);
+    void refreshPlacement(Server *server);
+    void markSnapshotChange(RegionShard &shard, Server *server, int change);
+    void recordEvent(FleetEventKind kind, Server *server, int oldStatus, int newStatus);
+    // nullptr when another server would exceed config.maxServers or config.maxCostPerHour
+    Server *createServer(RegionShard &shard, Constants::InstanceType instanceTypeInput);
+    Server *createServer(RegionShard &shard, Constants::InstanceType instanceTypeInput, bool modelBoot);
+    int64_t priceMicroUsd(Constants::InstanceType instanceType);
+    void queueRequest(RegionShard &shard, const RequestMessage &request);
+    void admitQueuedRequests(RegionShard &shard, bool allowSteal);
+    void signalBackpressure(Publisher &publisher);
+    ThreadMetrics *localMetrics();
+    string metricsLine();
+
     std::shared_ptr<std::ofstream> endOfDayReportFile;
-    std::mutex serversMutex;
-    // Servers that have # of processes between min and max thresholds
-    vector<std::shared_ptr<Server>> serverStatus0;
-    // Servers that have # of processes smaller than the min threshold
-    vector<std::shared_ptr<Server>> serverStatus1;
-    // Servers that have # of processes larger than the max threshold
-    vector<std::shared_ptr<Server>> serverStatus2;
-    // Servers that have maximum possible # of processes
-    vector<std::shared_ptr<Server>> serverStatus3;
+    ShardTotals lastDayTotals;
+    // Days reported so far, indexes config.dailyCostLowerBounds
+    int completedDays;
+    RegionConfig config;
+    std::shared_ptr<SimClock> clock;
+    // Binary record of every fleet change, render it with renderEventLog
+    EventLog eventLog;
+    atomic<uint32_t> nextServerId;
+    // The region's servers, partitioned so that placements on different
+    // shards do not wait for each other
+    vector<unique_ptr<RegionShard>> shards;
+    // Where the next placement starts looking for a free shard
+    atomic<unsigned int> nextShard;
+    // Arrival rate forecast that drives pre-warming, only used with every shard locked
+    DemandForecaster demandForecaster;
+    atomic<int> arrivalsSinceTick;
+    // Optional cross-region placement, nullptr when the region runs alone
+    GlobalCoordinator *coordinator;
+    int coordinatorIndex;
+    // Totals behind the snapshot published to the coordinator. Any shard may
+    // change them, whichever holds snapshotMutex publishes for all of them
+    atomic<int> freeSlots;
+    atomic<int> serverCount;
+    atomic<int> runningProcesses;
+    // Hourly price of the open servers in millionths of a USD, held against config.maxCostPerHour
+    atomic<int64_t> hourlyCostMicroUsd;
+    std::mutex snapshotMutex;
+    atomic<bool> snapshotDirty;
+    // Completes running processes when their execution time is over, and
+    // fires server boots and maintenance ticks
+    ProcessScheduler processScheduler;
+    // Places requests handed over by the message receiver
+    PlacementPool placementPool;
+    // Requests that wait for room while the fleet is at its limits
+    AdmissionQueue admissionQueue;
+    // Whether the receiver asked the publisher to hold back, only used by the receiver thread
+    bool backpressured;
+    // Requests in a payload that failed to decode, skipped instead of placed
+    atomic<unsigned long long> malformedRequests;
+    RegionMetrics metrics;
+    // Only set when config.metricsTarget is
+    unique_ptr<MetricsExporter> metricsExporter;
+    // Only set when config.snapshotPrefix is
+    unique_ptr<FleetSnapshotWriter> snapshotWriter;
+    // Prints regionalReport every config.reportIntervalSeconds on a real clock
+    thread reportThread;
+    std::mutex reportMutex;
+    std::condition_variable reportCondition;
+    bool stoppingReports;
 };
 
 #endif
\ No newline at end of file
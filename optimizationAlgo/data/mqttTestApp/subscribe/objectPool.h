@@ -0,0 +1,165 @@
+#ifndef OBJECT_POOL
+#define OBJECT_POOL
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// Reference to an object of an ObjectPool. It goes stale when the object is
+// released, even if its slot is reused for a new object afterwards
+template <typename T>
+struct PoolHandle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const PoolHandle &other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+};
+
+// Fixed-address storage for objects that are created and destroyed all the
+// time. Released slots are reused before new chunks are allocated, so once
+// the pool has grown to its high-water mark acquiring and releasing objects
+// never allocates. Objects never move, plain pointers to them stay valid
+// until they are released. The pool is not thread safe, the owner guards it
+template <typename T>
+class ObjectPool
+{
+public:
+    explicit ObjectPool(uint32_t chunkSizeInput = 256)
+    {
+        chunkSize = chunkSizeInput;
+        freeHead = UINT32_MAX;
+        slotCount = 0;
+        liveCount = 0;
+    }
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    ~ObjectPool()
+    {
+        for (uint32_t index = 0; index < slotCount; ++index)
+        {
+            Slot &slot = slotAt(index);
+            if (slot.live)
+            {
+                object(slot)->~T();
+            }
+        }
+    }
+
+    // Construct an object in a free slot
+    template <typename... Args>
+    PoolHandle<T> acquire(Args &&...args)
+    {
+        if (freeHead == UINT32_MAX)
+        {
+            grow();
+        }
+        uint32_t index = freeHead;
+        Slot &slot = slotAt(index);
+        new (slot.storage) T(std::forward<Args>(args)...);
+        freeHead = slot.nextFree;
+        slot.live = true;
+        ++liveCount;
+        return {index, slot.generation};
+    }
+
+    // Destroy the object, every handle to it goes stale. Stale handles are ignored
+    void release(PoolHandle<T> handle)
+    {
+        if (get(handle) == nullptr)
+        {
+            return;
+        }
+        Slot &slot = slotAt(handle.index);
+        object(slot)->~T();
+        slot.live = false;
+        ++slot.generation;
+        slot.nextFree = freeHead;
+        freeHead = handle.index;
+        --liveCount;
+    }
+
+    // The object of the handle, nullptr if it has been released
+    T *get(PoolHandle<T> handle) const
+    {
+        if (handle.index >= slotCount)
+        {
+            return nullptr;
+        }
+        Slot &slot = slotAt(handle.index);
+        if (!slot.live || slot.generation != handle.generation)
+        {
+            return nullptr;
+        }
+        return object(slot);
+    }
+
+    // Handle of an object that lives in this pool
+    PoolHandle<T> handleOf(const T *value) const
+    {
+        const Slot *slot = reinterpret_cast<const Slot *>(value);
+        return {slot->index, slot->generation};
+    }
+
+    size_t size() const
+    {
+        return liveCount;
+    }
+
+    size_t capacity() const
+    {
+        return slotCount;
+    }
+
+private:
+    // The storage comes first so an object and its slot share an address
+    struct Slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+        uint32_t index;
+        uint32_t generation;
+        uint32_t nextFree;
+        bool live;
+    };
+
+    static T *object(Slot &slot)
+    {
+        return std::launder(reinterpret_cast<T *>(slot.storage));
+    }
+
+    Slot &slotAt(uint32_t index) const
+    {
+        return chunks[index / chunkSize][index % chunkSize];
+    }
+
+    // Add a chunk of free slots, in index order so the first one is used first
+    void grow()
+    {
+        chunks.push_back(std::make_unique<Slot[]>(chunkSize));
+        Slot *chunk = chunks.back().get();
+        for (uint32_t i = 0; i < chunkSize; ++i)
+        {
+            chunk[i].index = slotCount + i;
+            chunk[i].generation = 0;
+            chunk[i].nextFree = i + 1 < chunkSize ? slotCount + i + 1 : freeHead;
+            chunk[i].live = false;
+        }
+        freeHead = slotCount;
+        slotCount += chunkSize;
+    }
+
+    uint32_t chunkSize;
+    vector<unique_ptr<Slot[]>> chunks;
+    uint32_t freeHead;
+    uint32_t slotCount;
+    size_t liveCount;
+};
+
+#endif
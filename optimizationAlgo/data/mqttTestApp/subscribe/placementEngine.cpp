@@ -0,0 +1,161 @@
+#include <limits>
+#include "placementEngine.h"
+using namespace std;
+
+std::optional<PlacementPolicy> parsePlacementPolicy(const string &name)
+{
+    if (name == "status-order")
+    {
+        return PlacementPolicy::StatusOrder;
+    }
+    if (name == "first-fit")
+    {
+        return PlacementPolicy::FirstFit;
+    }
+    if (name == "best-fit")
+    {
+        return PlacementPolicy::BestFit;
+    }
+    if (name == "worst-fit")
+    {
+        return PlacementPolicy::WorstFit;
+    }
+    if (name == "dot-product")
+    {
+        return PlacementPolicy::DotProduct;
+    }
+    return std::nullopt;
+}
+
+//////////////////
+// Placement engine class implementation
+PlacementEngine::PlacementEngine(PlacementPolicy policyInput)
+{
+    policy = policyInput;
+}
+
+PlacementPolicy PlacementEngine::getPolicy()
+{
+    return policy;
+}
+
+// Take a slot from the free list or grow the arrays. A new server starts
+// ineligible until its first update
+int PlacementEngine::addServer(Server *server, int capacityVcpuMilli, int capacityMemoryMb)
+{
+    int slot;
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        slot = servers.size();
+        freeVcpu.push_back(-1);
+        freeMemory.push_back(-1);
+        inverseCapacityVcpu.push_back(0);
+        inverseCapacityMemory.push_back(0);
+        servers.push_back(nullptr);
+    }
+
+    freeVcpu[slot] = -1;
+    freeMemory[slot] = -1;
+    inverseCapacityVcpu[slot] = 1000.0f / capacityVcpuMilli;
+    inverseCapacityMemory[slot] = 1024.0f / capacityMemoryMb;
+    servers[slot] = server;
+    return slot;
+}
+
+void PlacementEngine::removeServer(int slot)
+{
+    freeVcpu[slot] = -1;
+    freeMemory[slot] = -1;
+    servers[slot] = nullptr;
+    freeSlots.push_back(slot);
+}
+
+void PlacementEngine::updateServer(int slot, int freeVcpuMilli, int freeMemoryMb, bool eligible)
+{
+    freeVcpu[slot] = eligible ? freeVcpuMilli / 1000.0f : -1;
+    freeMemory[slot] = eligible ? freeMemoryMb / 1024.0f : -1;
+}
+
+int PlacementEngine::selectServer(int vCpuMilli, int memoryMb) const
+{
+    float demandVcpu = vCpuMilli / 1000.0f;
+    float demandMemory = memoryMb / 1024.0f;
+    if (policy == PlacementPolicy::FirstFit)
+    {
+        return selectFirstFit(demandVcpu, demandMemory);
+    }
+    return selectByScore(demandVcpu, demandMemory);
+}
+
+Server *PlacementEngine::serverAt(int slot) const
+{
+    return servers[slot];
+}
+
+size_t PlacementEngine::serverCount() const
+{
+    return servers.size() - freeSlots.size();
+}
+
+int PlacementEngine::selectFirstFit(float demandVcpu, float demandMemory) const
+{
+    const float *vCpu = freeVcpu.data();
+    const float *memory = freeMemory.data();
+    size_t count = freeVcpu.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (vCpu[i] >= demandVcpu && memory[i] >= demandMemory)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Score every slot, slots without room score negative infinity. Best fit
+// prefers the smallest normalized leftover, worst fit the largest, and the
+// dot product the largest alignment between demand and free capacity
+int PlacementEngine::selectByScore(float demandVcpu, float demandMemory) const
+{
+    const float *vCpu = freeVcpu.data();
+    const float *memory = freeMemory.data();
+    const float *inverseVcpu = inverseCapacityVcpu.data();
+    const float *inverseMemory = inverseCapacityMemory.data();
+    size_t count = freeVcpu.size();
+
+    const float noFit = -numeric_limits<float>::infinity();
+    float bestScore = noFit;
+    int bestSlot = -1;
+    for (size_t i = 0; i < count; ++i)
+    {
+        float leftoverVcpu = (vCpu[i] - demandVcpu) * inverseVcpu[i];
+        float leftoverMemory = (memory[i] - demandMemory) * inverseMemory[i];
+        float score;
+        if (policy == PlacementPolicy::BestFit)
+        {
+            score = -(leftoverVcpu + leftoverMemory);
+        }
+        else if (policy == PlacementPolicy::WorstFit)
+        {
+            score = leftoverVcpu + leftoverMemory;
+        }
+        else
+        {
+            score = demandVcpu * inverseVcpu[i] * vCpu[i] * inverseVcpu[i] +
+                    demandMemory * inverseMemory[i] * memory[i] * inverseMemory[i];
+        }
+        bool fits = vCpu[i] >= demandVcpu && memory[i] >= demandMemory;
+        score = fits ? score : noFit;
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestSlot = i;
+        }
+    }
+    return bestSlot;
+}
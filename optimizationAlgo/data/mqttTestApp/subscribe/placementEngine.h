@@ -0,0 +1,63 @@
+#ifndef PLACEMENT_ENGINE
+#define PLACEMENT_ENGINE
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+using namespace std;
+
+class Server;
+
+// How a request picks its server
+enum class PlacementPolicy
+{
+    // Front of the lowest eligible status bucket, the original behaviour
+    StatusOrder,
+    // First server, in slot order, with room for the request
+    FirstFit,
+    // Server left with the least free capacity after placement
+    BestFit,
+    // Server left with the most free capacity after placement
+    WorstFit,
+    // Server whose free capacity points most in the direction of the demand
+    DotProduct,
+};
+
+std::optional<PlacementPolicy> parsePlacementPolicy(const string &name);
+
+// Free vCPU and memory of every server of a region, kept as a structure of
+// arrays indexed by a slot that stays with the server for its whole life.
+// Selecting a server is a single pass over plain arrays that the compiler
+// can vectorise. The caller serializes access (the shard mutex)
+class PlacementEngine
+{
+public:
+    explicit PlacementEngine(PlacementPolicy policyInput);
+    PlacementPolicy getPolicy();
+
+    // Returns the slot of the new server
+    int addServer(Server *server, int capacityVcpuMilli, int capacityMemoryMb);
+    void removeServer(int slot);
+    void updateServer(int slot, int freeVcpuMilli, int freeMemoryMb, bool eligible);
+
+    // Returns the slot of the server chosen for the demand, -1 if no server has room
+    int selectServer(int vCpuMilli, int memoryMb) const;
+    Server *serverAt(int slot) const;
+    size_t serverCount() const;
+
+private:
+    int selectFirstFit(float demandVcpu, float demandMemory) const;
+    int selectByScore(float demandVcpu, float demandMemory) const;
+
+    PlacementPolicy policy;
+    // Free capacity and capacity in vCPU and GB, a slot that is not eligible
+    // has its free capacity set to -1 so it never fits
+    vector<float> freeVcpu;
+    vector<float> freeMemory;
+    vector<float> inverseCapacityVcpu;
+    vector<float> inverseCapacityMemory;
+    vector<Server *> servers;
+    vector<int> freeSlots;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "placementPool.h"
+#include "appConst.h"
+using namespace std;
+
+//////////////////
+// Placement pool class implementation
+PlacementPool::PlacementPool(int threadCountInput, size_t queueDepth, function<void(vector<PlacementRequest> &batch)> placeBatch)
+    : queue(queueDepth)
+{
+    threadCount = threadCountInput > 0 ? threadCountInput : 1;
+    placeBatchCallback = placeBatch;
+    running = false;
+    sleepingWorkers = 0;
+    submitted = 0;
+    completed = 0;
+    maxQueueDepth = 0;
+}
+
+PlacementPool::~PlacementPool()
+{
+    stop();
+}
+
+void PlacementPool::start()
+{
+    if (running.exchange(true))
+    {
+        return;
+    }
+    for (int i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back(&PlacementPool::run, this);
+    }
+}
+
+// Stop the workers once they finished their current batch
+void PlacementPool::stop()
+{
+    if (!running.exchange(false))
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    wakeCondition.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void PlacementPool::submit(const PlacementRequest &request)
+{
+    // A full queue means the workers are behind, wait for them instead of
+    // dropping the request
+    while (!queue.tryPush(request))
+    {
+        wakeWorker();
+        this_thread::yield();
+    }
+    ++submitted;
+
+    size_t depth = queue.size();
+    size_t previousMax = maxQueueDepth.load(memory_order_relaxed);
+    while (depth > previousMax && !maxQueueDepth.compare_exchange_weak(previousMax, depth, memory_order_relaxed))
+    {
+    }
+
+    wakeWorker();
+}
+
+// Only take the mutex when a worker is actually asleep. The fence pairs with
+// the one in run() so that either the worker sees the new request or the
+// submitter sees the sleeping worker
+void PlacementPool::wakeWorker()
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (sleepingWorkers.load(memory_order_relaxed) > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+        }
+        wakeCondition.notify_one();
+    }
+}
+
+void PlacementPool::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(idleMutex);
+    idleCondition.wait(lock, [this]()
+                       { return completed.load() == submitted.load(); });
+}
+
+PlacementPoolStats PlacementPool::getStats()
+{
+    PlacementPoolStats stats;
+    stats.placed = completed.load();
+    stats.queueDepth = queue.size();
+    stats.maxQueueDepth = maxQueueDepth.load();
+    stats.averageWaitMs = waitNs.mean() / 1e6;
+    stats.p50WaitMs = waitNs.percentile(0.5) / 1e6;
+    stats.p99WaitMs = waitNs.percentile(0.99) / 1e6;
+    stats.maxWaitMs = waitNs.max() / 1e6;
+    return stats;
+}
+
+HistogramSnapshot PlacementPool::getWaitHistogram()
+{
+    return waitNs.snapshot();
+}
+
+// Take up to a batch worth of requests, place them and record how long each
+// of them waited between submission and placement
+void PlacementPool::run()
+{
+    vector<PlacementRequest> batch;
+    batch.reserve(Constants::maxReceiveBatch);
+    PlacementRequest request;
+
+    while (running.load())
+    {
+        while (batch.size() < (size_t)Constants::maxReceiveBatch && queue.tryPop(request))
+        {
+            batch.push_back(request);
+        }
+
+        if (batch.empty())
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            sleepingWorkers.fetch_add(1, memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (queue.size() == 0 && running.load())
+            {
+                wakeCondition.wait_for(lock, chrono::milliseconds(Constants::receiveTimeoutMs));
+            }
+            sleepingWorkers.fetch_sub(1, memory_order_relaxed);
+            continue;
+        }
+
+        placeBatchCallback(batch);
+
+        auto now = chrono::steady_clock::now();
+        for (const auto &placed : batch)
+        {
+            waitNs.record(chrono::duration_cast<chrono::nanoseconds>(now - placed.enqueuedAt).count());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            completed += batch.size();
+        }
+        idleCondition.notify_all();
+        batch.clear();
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef PLACEMENT_POOL
+#define PLACEMENT_POOL
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../common/boundedQueue.h"
+#include "../common/latencyHistogram.h"
+#include "../common/requestMessage.h"
+using namespace std;
+
+// A request waiting to be placed on a server
+struct PlacementRequest
+{
+    RequestMessage request;
+    std::chrono::steady_clock::time_point enqueuedAt;
+};
+
+// Queue depth and waiting time figures of a placement pool
+struct PlacementPoolStats
+{
+    unsigned long long placed;
+    size_t queueDepth;
+    size_t maxQueueDepth;
+    double averageWaitMs;
+    double p50WaitMs;
+    double p99WaitMs;
+    double maxWaitMs;
+};
+
+// Fixed set of worker threads that take requests from a bounded lock-free
+// queue and hand them in batches to the region for placement
+class PlacementPool
+{
+public:
+    PlacementPool(int threadCountInput, size_t queueDepth, function<void(vector<PlacementRequest> &batch)> placeBatch);
+    ~PlacementPool();
+    void start();
+    void stop();
+    // Blocks while the queue is full
+    void submit(const PlacementRequest &request);
+    // Blocks until every submitted request has been placed
+    void waitIdle();
+    PlacementPoolStats getStats();
+    HistogramSnapshot getWaitHistogram();
+
+private:
+    void run();
+    void wakeWorker();
+
+    int threadCount;
+    function<void(vector<PlacementRequest> &batch)> placeBatchCallback;
+    BoundedQueue<PlacementRequest> queue;
+    vector<thread> workers;
+    atomic<bool> running;
+
+    // Workers only take the mutex to sleep when the queue is empty
+    atomic<int> sleepingWorkers;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+
+    atomic<unsigned long long> submitted;
+    atomic<unsigned long long> completed;
+    std::mutex idleMutex;
+    std::condition_variable idleCondition;
+
+    atomic<size_t> maxQueueDepth;
+    // Time from submission until placement in nanoseconds
+    LatencyHistogram waitNs;
+};
+
+#endif
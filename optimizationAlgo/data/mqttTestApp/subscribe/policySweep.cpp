@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include "policySweep.h"
+#include "discreteEventSim.h"
+#include "../common/workStealingPool.h"
+using namespace std;
+
+// Nearest-rank quantile of the values
+static double quantileOf(vector<double> values, double quantile)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    size_t rank = (size_t)std::ceil(quantile * values.size());
+    rank = std::min(values.size(), std::max<size_t>(1, rank));
+    std::nth_element(values.begin(), values.begin() + (rank - 1), values.end());
+    return values[rank - 1];
+}
+
+static double meanOf(const vector<double> &values)
+{
+    return values.empty() ? 0 : std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+}
+
+static double stddevOf(const vector<double> &values)
+{
+    if (values.size() < 2)
+    {
+        return 0;
+    }
+    double mean = meanOf(values);
+    double squares = 0;
+    for (double value : values)
+    {
+        squares += (value - mean) * (value - mean);
+    }
+    return std::sqrt(squares / (values.size() - 1));
+}
+
+// One field of the days, for the distributions
+static vector<double> column(const vector<SweepDay> &days, double SweepDay::*field)
+{
+    vector<double> values;
+    values.reserve(days.size());
+    for (const auto &day : days)
+    {
+        values.push_back(day.*field);
+    }
+    return values;
+}
+
+// Replace every point by one copy per value of the next parameter
+template <typename T, typename Setter>
+static void expandPoints(vector<SweepPoint> &points, const vector<T> &values, Setter set)
+{
+    vector<SweepPoint> expanded;
+    for (const auto &point : points)
+    {
+        for (const auto &value : values)
+        {
+            SweepPoint next = point;
+            set(next, value);
+            expanded.push_back(next);
+        }
+    }
+    points.swap(expanded);
+}
+
+//////////////////
+// Policy sweep class implementation
+PolicySweep::PolicySweep(const SweepOptions &optionsInput)
+{
+    options = optionsInput;
+    if (options.regions.empty() || options.policies.empty() || options.minThresholdScales.empty() ||
+        options.maxThresholdScales.empty() || options.scaleUpStatuses.empty() || options.scalingHeadrooms.empty())
+    {
+        throw std::invalid_argument("Every swept parameter needs at least one value");
+    }
+    for (const auto &regionName : options.regions)
+    {
+        if (!Constants::parseRegion(regionName))
+        {
+            throw std::invalid_argument("Unknown region: " + regionName);
+        }
+    }
+    for (const auto &policyName : options.policies)
+    {
+        if (!parsePlacementPolicy(policyName))
+        {
+            throw std::invalid_argument("Unknown placement policy: " + policyName);
+        }
+    }
+    for (int status : options.scaleUpStatuses)
+    {
+        if (status != 2 && status != 3)
+        {
+            throw std::invalid_argument("The scale up status must be 2 or 3");
+        }
+    }
+    // The scaled thresholds are clamped below the absolute limit, which needs a
+    // valid base to clamp into
+    for (const Constants::Capacity &capacity : options.baseConfig.processCapacity)
+    {
+        if (capacity.minThreshold < 0 || capacity.minThreshold > capacity.maxThreshold || capacity.maxThreshold < 1 || capacity.maxThreshold >= capacity.absoluteLimit)
+        {
+            throw std::invalid_argument("Base process capacity thresholds must satisfy 0 <= min <= max < absolute limit and max >= 1");
+        }
+    }
+    if (options.threads <= 0)
+    {
+        options.threads = std::max(1u, thread::hardware_concurrency());
+    }
+
+    points = {SweepPoint()};
+    expandPoints(points, options.regions, [](SweepPoint &point, const string &value)
+                 { point.regionName = value; });
+    expandPoints(points, options.policies, [](SweepPoint &point, const string &value)
+                 { point.policyName = value; });
+    expandPoints(points, options.minThresholdScales, [](SweepPoint &point, double value)
+                 { point.minThresholdScale = value; });
+    expandPoints(points, options.maxThresholdScales, [](SweepPoint &point, double value)
+                 { point.maxThresholdScale = value; });
+    expandPoints(points, options.scaleUpStatuses, [](SweepPoint &point, int value)
+                 { point.scaleUpStatus = value; });
+    expandPoints(points, options.scalingHeadrooms, [](SweepPoint &point, double value)
+                 { point.scalingHeadroom = value; });
+    pointDays.resize(points.size());
+    finishedRuns = 0;
+    failedRuns = 0;
+}
+
+vector<SweepPoint> PolicySweep::getPoints()
+{
+    return points;
+}
+
+// The base config with the point's parameters. Runs never write log files,
+// they would all write to the same ones
+RegionConfig PolicySweep::configFor(const RegionConfig &baseConfig, const SweepPoint &point)
+{
+    RegionConfig config = baseConfig;
+    config.placementPolicy = *parsePlacementPolicy(point.policyName);
+    config.scaleUpStatus = point.scaleUpStatus;
+    config.scalingHeadroom = point.scalingHeadroom;
+    config.writeLogFiles = false;
+    // Runs only read their day totals
+    config.collectMetrics = false;
+    config.metricsTarget.clear();
+    for (auto &capacity : config.processCapacity)
+    {
+        capacity.maxThreshold = std::clamp((int)std::lround(capacity.maxThreshold * point.maxThresholdScale), 1, capacity.absoluteLimit - 1);
+        capacity.minThreshold = std::clamp((int)std::lround(capacity.minThreshold * point.minThresholdScale), 0, capacity.maxThreshold);
+    }
+    return config;
+}
+
+int PolicySweep::run()
+{
+    runsFile.open(options.outputPrefix + "_runs.csv", ios::trunc);
+    if (!runsFile)
+    {
+        throw std::runtime_error("Cannot write " + options.outputPrefix + "_runs.csv");
+    }
+    runsFile << "point,region,policy,min_scale,max_scale,scale_up_status,headroom,seed,days,"
+             << "cost_mean,cost_p50,cost_p95,holdup_mean,holdup_p95,scalings_mean,scalings_p95,processes_mean,wall_seconds\n";
+
+    size_t totalRuns = points.size() * options.seeds;
+    cerr << "Sweeping " << points.size() << " points x " << options.seeds << " seeds x " << options.daysPerRun
+         << " days on " << options.threads << " threads" << endl;
+    auto start = chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(options.threads);
+        // Seed by seed, so the early lines of the runs file already cover every point
+        for (int seedIndex = 0; seedIndex < options.seeds; ++seedIndex)
+        {
+            for (size_t pointIndex = 0; pointIndex < points.size(); ++pointIndex)
+            {
+                unsigned int seed = options.firstSeed + seedIndex;
+                pool.submit([this, pointIndex, seed, totalRuns]()
+                            {
+                                auto runStart = chrono::steady_clock::now();
+                                vector<SweepDay> days;
+                                try
+                                {
+                                    days = runOne(points[pointIndex], seed);
+                                }
+                                catch (const std::exception &error)
+                                {
+                                    std::lock_guard<std::mutex> lock(resultsMutex);
+                                    cerr << "Run of point " << pointIndex << " with seed " << seed << " failed: " << error.what() << endl;
+                                    ++failedRuns;
+                                    ++finishedRuns;
+                                    return;
+                                }
+                                writeRun(pointIndex, seed, days, chrono::duration<double>(chrono::steady_clock::now() - runStart).count());
+                                std::lock_guard<std::mutex> lock(resultsMutex);
+                                if (++finishedRuns % std::max<size_t>(1, totalRuns / 20) == 0)
+                                {
+                                    cerr << finishedRuns << "/" << totalRuns << " runs" << endl;
+                                } });
+            }
+        }
+        pool.waitIdle();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    writeSummary();
+    cerr << "Simulated " << (totalRuns - failedRuns) * options.daysPerRun << " days in " << seconds << " seconds" << endl;
+    return failedRuns;
+}
+
+vector<SweepDay> PolicySweep::runOne(const SweepPoint &point, unsigned int seed)
+{
+    RegionConfig config = configFor(options.baseConfig, point);
+    DiscreteEventSimulation simulation(point.regionName, seed, config, options.arrivals);
+    vector<SweepDay> days;
+    days.reserve(options.daysPerRun);
+    for (int day = 1; day <= options.daysPerRun; ++day)
+    {
+        simulation.runDays(day);
+        ShardTotals totals = simulation.getRegion().getLastDayTotals();
+        SweepDay result;
+        result.cost = totals.serverCost;
+        result.holdupSeconds = config.modelServerBoot ? totals.processHoldup : totals.scalings * Constants::averageServerBootDuration;
+        result.scalings = totals.scalings;
+        result.processes = totals.processes;
+        days.push_back(result);
+    }
+    return days;
+}
+
+void PolicySweep::writeRun(size_t pointIndex, unsigned int seed, const vector<SweepDay> &days, double seconds)
+{
+    vector<double> costs = column(days, &SweepDay::cost);
+    vector<double> holdups = column(days, &SweepDay::holdupSeconds);
+    vector<double> scalings = column(days, &SweepDay::scalings);
+    const SweepPoint &point = points[pointIndex];
+
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    runsFile << pointIndex << "," << point.regionName << "," << point.policyName << "," << point.minThresholdScale << ","
+             << point.maxThresholdScale << "," << point.scaleUpStatus << "," << point.scalingHeadroom << "," << seed << ","
+             << days.size() << "," << meanOf(costs) << "," << quantileOf(costs, 0.5) << "," << quantileOf(costs, 0.95) << ","
+             << meanOf(holdups) << "," << quantileOf(holdups, 0.95) << "," << meanOf(scalings) << "," << quantileOf(scalings, 0.95) << ","
+             << meanOf(column(days, &SweepDay::processes)) << "," << seconds << "\n";
+    runsFile.flush();
+    pointDays[pointIndex].insert(pointDays[pointIndex].end(), days.begin(), days.end());
+}
+
+// One line per point with the distributions over all of its days, cheapest first
+void PolicySweep::writeSummary()
+{
+    ofstream summaryFile(options.outputPrefix + "_summary.csv", ios::trunc);
+    if (!summaryFile)
+    {
+        throw std::runtime_error("Cannot write " + options.outputPrefix + "_summary.csv");
+    }
+    summaryFile << "point,region,policy,min_scale,max_scale,scale_up_status,headroom,days,"
+                << "cost_mean,cost_stddev,cost_p5,cost_p50,cost_p95,holdup_mean,holdup_p50,holdup_p95,"
+                << "scalings_mean,scalings_p50,scalings_p95,cost_per_process\n";
+
+    vector<size_t> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    vector<double> meanCost(points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        meanCost[i] = meanOf(column(pointDays[i], &SweepDay::cost));
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                     { return meanCost[a] < meanCost[b]; });
+
+    for (size_t pointIndex : order)
+    {
+        const SweepPoint &point = points[pointIndex];
+        const vector<SweepDay> &days = pointDays[pointIndex];
+        if (days.empty())
+        {
+            continue;
+        }
+        vector<double> costs = column(days, &SweepDay::cost);
+        vector<double> holdups = column(days, &SweepDay::holdupSeconds);
+        vector<double> scalings = column(days, &SweepDay::scalings);
+        double processes = std::accumulate(days.begin(), days.end(), 0.0, [](double sum, const SweepDay &day)
+                                           { return sum + day.processes; });
+        summaryFile << pointIndex << "," << point.regionName << "," << point.policyName << "," << point.minThresholdScale << ","
+                    << point.maxThresholdScale << "," << point.scaleUpStatus << "," << point.scalingHeadroom << "," << days.size() << ","
+                    << meanOf(costs) << "," << stddevOf(costs) << "," << quantileOf(costs, 0.05) << "," << quantileOf(costs, 0.5) << ","
+                    << quantileOf(costs, 0.95) << "," << meanOf(holdups) << "," << quantileOf(holdups, 0.5) << "," << quantileOf(holdups, 0.95) << ","
+                    << meanOf(scalings) << "," << quantileOf(scalings, 0.5) << "," << quantileOf(scalings, 0.95) << ","
+                    << (processes > 0 ? std::accumulate(costs.begin(), costs.end(), 0.0) / processes : 0) << "\n";
+    }
+}
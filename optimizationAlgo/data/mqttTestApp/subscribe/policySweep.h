@@ -0,0 +1,87 @@
+#ifndef POLICY_SWEEP
+#define POLICY_SWEEP
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../common/requestSource.h"
+#include "regionConfig.h"
+using namespace std;
+
+// One combination of the swept parameters
+struct SweepPoint
+{
+    string regionName;
+    string policyName;
+    // Every instance type's minThreshold and maxThreshold are multiplied by
+    // these, then kept within 0 <= min <= max < absoluteLimit
+    double minThresholdScale;
+    double maxThresholdScale;
+    int scaleUpStatus;
+    // Only changes anything with predictive scaling on
+    double scalingHeadroom;
+};
+
+// The grid is the product of every list, each point runs once per seed
+struct SweepOptions
+{
+    vector<string> regions = {"Oregon"};
+    vector<string> policies = {"status-order"};
+    vector<double> minThresholdScales = {1};
+    vector<double> maxThresholdScales = {1};
+    vector<int> scaleUpStatuses = {2};
+    vector<double> scalingHeadrooms = {0.2};
+    // Seeds firstSeed to firstSeed + seeds - 1, the same for every point so
+    // the points are compared on the same days
+    int seeds = 10;
+    unsigned int firstSeed = 1;
+    int daysPerRun = 10;
+    int threads = 0;
+    // Settings of every run that are not swept
+    RegionConfig baseConfig;
+    ArrivalOptions arrivals;
+    // Results go to <prefix>_runs.csv and <prefix>_summary.csv
+    string outputPrefix = "sweep";
+};
+
+// End of day figures of one simulated day. Without boot modelling the
+// holdup is the nominal boot time of every scale up, like the end of day report
+struct SweepDay
+{
+    double cost;
+    double holdupSeconds;
+    double scalings;
+    double processes;
+};
+
+// Runs a region simulation for every point of a parameter grid and every
+// seed on a work-stealing thread pool. Each run appends its line to the runs
+// file as soon as it finishes, the per point distributions over all seeds
+// and days are written once the sweep is over
+class PolicySweep
+{
+public:
+    // Throws std::invalid_argument for unknown regions or policies and empty lists
+    PolicySweep(const SweepOptions &optionsInput);
+    vector<SweepPoint> getPoints();
+    // Returns the number of runs that failed
+    int run();
+    static RegionConfig configFor(const RegionConfig &baseConfig, const SweepPoint &point);
+
+private:
+    vector<SweepDay> runOne(const SweepPoint &point, unsigned int seed);
+    void writeRun(size_t pointIndex, unsigned int seed, const vector<SweepDay> &days, double seconds);
+    void writeSummary();
+
+    SweepOptions options;
+    vector<SweepPoint> points;
+
+    std::mutex resultsMutex;
+    std::ofstream runsFile;
+    // Every day of every seed, per point
+    vector<vector<SweepDay>> pointDays;
+    size_t finishedRuns;
+    int failedRuns;
+};
+
+#endif
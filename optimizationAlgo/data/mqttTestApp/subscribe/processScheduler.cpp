@@ -0,0 +1,169 @@
+#include "processScheduler.h"
+using namespace std;
+
+//////////////////
+// Process scheduler class implementation
+ProcessScheduler::ProcessScheduler(function<void(const ScheduledEvent &event)> onDue)
+{
+    onDueCallback = onDue;
+    nextSequence = 0;
+    running = false;
+}
+
+ProcessScheduler::~ProcessScheduler()
+{
+    stop();
+}
+
+// Launch the worker thread that waits for the earliest deadline
+void ProcessScheduler::start()
+{
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (running)
+    {
+        return;
+    }
+    running = true;
+    workerThread = thread(&ProcessScheduler::run, this);
+}
+
+// Stop the worker thread, processes that are still pending are dropped
+void ProcessScheduler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        running = false;
+    }
+    pendingChanged.notify_all();
+    if (workerThread.joinable())
+    {
+        workerThread.join();
+    }
+}
+
+// Register a process completion, the process knows which server it runs on
+void ProcessScheduler::schedule(std::chrono::steady_clock::time_point deadline, int shard, PoolHandle<Process> process)
+{
+    push({deadline, 0, ScheduledEventKind::ProcessCompletion, shard, {}, process});
+}
+
+// Register an entry that is not tied to a process
+void ProcessScheduler::scheduleEvent(ScheduledEventKind kind, std::chrono::steady_clock::time_point deadline, int shard, PoolHandle<Server> server)
+{
+    push({deadline, 0, kind, shard, server, {}});
+}
+
+// Rebuilding the heap from all entries takes linear time, where pushing a
+// restored fleet's processes one by one would take a lock and a sift each
+void ProcessScheduler::scheduleAll(vector<ScheduledEvent> events)
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (auto &event : events)
+        {
+            event.sequence = nextSequence++;
+        }
+        while (!pending.empty())
+        {
+            events.push_back(pending.top());
+            pending.pop();
+        }
+        pending = priority_queue<ScheduledEvent, vector<ScheduledEvent>, LaterEvent>(LaterEvent(), std::move(events));
+    }
+    pendingChanged.notify_one();
+}
+
+// Add an entry to the heap, waking the worker only if the new deadline is
+// earlier than the one it is currently sleeping on
+void ProcessScheduler::push(ScheduledEvent event)
+{
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        earliest = pending.empty() || event.deadline < pending.top().deadline;
+        event.sequence = nextSequence++;
+        pending.push(std::move(event));
+    }
+    if (earliest)
+    {
+        pendingChanged.notify_one();
+    }
+}
+
+// Returning the number of entries that are not due yet
+size_t ProcessScheduler::pendingCount()
+{
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    return pending.size();
+}
+
+// Returning the earliest pending deadline, false if nothing is pending
+bool ProcessScheduler::nextDeadline(std::chrono::steady_clock::time_point &deadline)
+{
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (pending.empty())
+    {
+        return false;
+    }
+    deadline = pending.top().deadline;
+    return true;
+}
+
+// Dispatch every entry that is due at the given time on the calling thread
+void ProcessScheduler::dispatchDue(std::chrono::steady_clock::time_point now)
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        collectDue(now, dueEvents);
+    }
+    for (auto &event : dueEvents)
+    {
+        onDueCallback(event);
+    }
+    dueEvents.clear();
+}
+
+// Move every entry with a deadline up to now from the heap into due,
+// the caller holds pendingMutex
+void ProcessScheduler::collectDue(std::chrono::steady_clock::time_point now, vector<ScheduledEvent> &due)
+{
+    while (!pending.empty() && pending.top().deadline <= now)
+    {
+        due.push_back(pending.top());
+        pending.pop();
+    }
+}
+
+// Sleep until the earliest deadline, then collect every event that is due
+// and dispatch them outside of the lock so callbacks can schedule new processes
+void ProcessScheduler::run()
+{
+    vector<ScheduledEvent> due;
+    std::unique_lock<std::mutex> lock(pendingMutex);
+    while (running)
+    {
+        if (pending.empty())
+        {
+            pendingChanged.wait(lock);
+            continue;
+        }
+
+        auto now = chrono::steady_clock::now();
+        auto earliestDeadline = pending.top().deadline;
+        if (earliestDeadline > now)
+        {
+            pendingChanged.wait_until(lock, earliestDeadline);
+            continue;
+        }
+
+        collectDue(now, due);
+
+        lock.unlock();
+        for (auto &event : due)
+        {
+            onDueCallback(event);
+        }
+        due.clear();
+        lock.lock();
+    }
+}
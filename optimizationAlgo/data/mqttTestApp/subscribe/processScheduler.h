@@ -0,0 +1,95 @@
+#ifndef PROCESS_SCHEDULER
+#define PROCESS_SCHEDULER
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "objectPool.h"
+using namespace std;
+
+class Server;
+class Process;
+
+// What the region has to do when a scheduled entry becomes due
+enum class ScheduledEventKind
+{
+    // process finished running on server
+    ProcessCompletion,
+    // server finished booting and may start processes
+    ServerReady,
+    // periodic maintenance of the region (forecasting, pre-warming)
+    MaintenanceTick,
+    // periodic consolidation of underloaded servers
+    ConsolidationTick,
+    // periodic search for servers that a cheaper instance type could replace
+    RightSizingTick,
+};
+
+// A single entry waiting for its deadline. It names the server or process by
+// its handle in the pools of the region shard, the handle goes stale if the
+// object is released before the entry is due
+struct ScheduledEvent
+{
+    std::chrono::steady_clock::time_point deadline;
+    unsigned long long sequence;
+    ScheduledEventKind kind;
+    int shard;
+    PoolHandle<Server> server;
+    PoolHandle<Process> process;
+};
+
+// Orders the heap so that the earliest deadline (and among equal deadlines the
+// earliest scheduled entry) is on top
+struct LaterEvent
+{
+    bool operator()(const ScheduledEvent &a, const ScheduledEvent &b) const
+    {
+        if (a.deadline != b.deadline)
+        {
+            return a.deadline > b.deadline;
+        }
+        return a.sequence > b.sequence;
+    }
+};
+
+// Tracks the deadlines of every running process of a region in a min-heap and
+// fires their completions from a single worker thread, so a running process
+// costs one heap entry instead of one sleeping OS thread. Server boots and
+// periodic maintenance of the region go through the same heap. In the discrete-event
+// simulation no worker is started and the simulation dispatches due entries itself
+class ProcessScheduler
+{
+public:
+    ProcessScheduler(function<void(const ScheduledEvent &event)> onDue);
+    ~ProcessScheduler();
+    void start();
+    void stop();
+    void schedule(std::chrono::steady_clock::time_point deadline, int shard, PoolHandle<Process> process);
+    void scheduleEvent(ScheduledEventKind kind, std::chrono::steady_clock::time_point deadline, int shard = -1, PoolHandle<Server> server = {});
+    // Registers many entries under one lock, their sequence is assigned here
+    void scheduleAll(vector<ScheduledEvent> events);
+    size_t pendingCount();
+    // Used instead of start() when the region runs on a virtual clock
+    bool nextDeadline(std::chrono::steady_clock::time_point &deadline);
+    void dispatchDue(std::chrono::steady_clock::time_point now);
+
+private:
+    void run();
+    void push(ScheduledEvent event);
+    void collectDue(std::chrono::steady_clock::time_point now, vector<ScheduledEvent> &due);
+
+    function<void(const ScheduledEvent &event)> onDueCallback;
+    priority_queue<ScheduledEvent, vector<ScheduledEvent>, LaterEvent> pending;
+    unsigned long long nextSequence;
+    // Reused by dispatchDue so dispatching does not allocate
+    vector<ScheduledEvent> dueEvents;
+    bool running;
+    std::mutex pendingMutex;
+    std::condition_variable pendingChanged;
+    thread workerThread;
+};
+
+#endif
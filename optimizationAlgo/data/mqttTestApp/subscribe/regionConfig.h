@@ -0,0 +1,119 @@
+#ifndef REGION_CONFIG
+#define REGION_CONFIG
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "appConst.h"
+#include "placementEngine.h"
+using namespace std;
+
+// The thresholds of appConst.h as the starting point of every region
+inline constexpr std::array<Constants::Capacity, Constants::instanceTypeCount> defaultProcessCapacity()
+{
+    std::array<Constants::Capacity, Constants::instanceTypeCount> capacity{};
+    for (int i = 0; i < Constants::instanceTypeCount; ++i)
+    {
+        capacity[i] = Constants::processCapacityPerInstanceType[i];
+    }
+    return capacity;
+}
+
+// Tunables of a single region that may differ between deployments and runs
+struct RegionConfig
+{
+    // Number of threads placing requests on servers
+    int placementThreads = 2;
+    // Independent partitions of the fleet, each with its own lock. Placement
+    // scales with threads up to this many shards
+    int shardCount = 1;
+    // Requests that may wait for placement before the receiver blocks
+    size_t placementQueueDepth = 4096;
+    // Heuristic that picks the server for each request
+    PlacementPolicy placementPolicy = PlacementPolicy::StatusOrder;
+    // Process counts that move a server between statuses, per instance type.
+    // Each must satisfy minThreshold <= maxThreshold < absoluteLimit
+    std::array<Constants::Capacity, Constants::instanceTypeCount> processCapacity = defaultProcessCapacity();
+    // A server that reaches this status (2 or 3) launches the next larger
+    // server when the shard has no status 1 server left
+    int scaleUpStatus = 2;
+    // Write the <region>_endOfDay_log and <region>_realTime_events files.
+    // Sweeps run many copies of a region at once and turn them off
+    bool writeLogFiles = true;
+    // Fleet events that may wait for the event log writer
+    size_t eventLogCapacity = 1 << 16;
+    // Drop events when the writer falls behind instead of stalling placement,
+    // simulations turn this off to keep the log complete
+    bool dropEventsWhenFull = true;
+    // Servers take averageServerBootDuration to boot and processes placed on
+    // a booting server wait for it
+    bool modelServerBoot = false;
+    // Launch servers ahead of the forecast demand and close the ones that
+    // stayed idle, checked every forecastTickSeconds
+    bool predictiveScaling = false;
+    double forecastTickSeconds = 6;
+    // Capacity kept above the forecast, 0.2 keeps 20% spare process slots
+    double scalingHeadroom = 0.2;
+    int maxPrewarmPerTick = 2;
+    // An empty booted server is closed after this long if the forecast does not need it
+    double idleServerTimeoutSeconds = 30;
+    // Periodically move the processes of underloaded servers onto servers
+    // with headroom so the emptied servers close
+    bool consolidation = false;
+    double consolidationIntervalSeconds = 10;
+    // Consolidation runs with every RegionShard lock held (lockAllShards), so
+    // the placement it holds up is bounded by these
+    int maxMigrationsPerCycle = 8;
+    int maxConsolidationCandidates = 16;
+    // Pause a migrated process takes before it runs again on its new server
+    double migrationPauseSeconds = 0.5;
+    // A server is only drained if it would otherwise stay up at least this long
+    double minConsolidationGainSeconds = 10;
+    // Periodically replace servers whose load fits a cheaper instance type.
+    // The replacement boots next to the old server, which takes no new
+    // processes and hands its running ones over once the replacement is ready
+    bool rightSizing = false;
+    double rightSizingIntervalSeconds = 10;
+    // Right-sizing holds every shard lock too, this bounds its work the same way
+    int maxRightSizesPerCycle = 2;
+    // Admission control: the region never runs more than maxServers servers,
+    // nor servers whose prices add up to more than maxCostPerHour USD per
+    // hour, 0 for no limit. Requests that find no room wait in a queue of up
+    // to admissionQueueDepth requests and start as capacity frees up
+    int maxServers = 0;
+    double maxCostPerHour = 0;
+    size_t admissionQueueDepth = 4096;
+    // The receiver asks the publisher to hold back requests once the
+    // admission queue is this full, and to go on once it has drained to the low water mark
+    double backpressureHighWater = 0.75;
+    double backpressureLowWater = 0.25;
+    // Per-thread counters and latency histograms, read with getMetrics.
+    // scenarioBenchmark measures what they cost
+    bool collectMetrics = true;
+    // Where metrics snapshots go: a prefix of <prefix>_<region>.metrics files,
+    // or unix:<path> for a local datagram socket. Nothing is exported when empty
+    string metricsTarget;
+    // Seconds between exported snapshots on a real clock, on a virtual clock
+    // a snapshot is exported at every end of day instead
+    double metricsIntervalSeconds = 1;
+    // Print regionalReport every reportIntervalSeconds on a real clock, never
+    // when 0. It reads the fleet view, so the interval does not slow placement
+    double reportIntervalSeconds = 0;
+    // Save the region's servers, processes and totals to <prefix>_<region>.fleet
+    // every snapshotIntervalSeconds on a real clock, or at every end of day on a
+    // virtual one, and when the consumer quits. Nothing is saved when empty
+    string snapshotPrefix;
+    double snapshotIntervalSeconds = 5;
+    // Start from that snapshot, if there is one, instead of an empty fleet
+    bool restoreSnapshot = false;
+    // Offline lower bound on the cost of each day from LowerBoundSolver. When
+    // set, the end of day report adds the competitive ratio of the day
+    vector<double> dailyCostLowerBounds;
+
+    const Constants::Capacity &capacityOf(Constants::InstanceType instanceType) const
+    {
+        return processCapacity[Constants::toIndex(instanceType)];
+    }
+};
+
+#endif
@@ -0,0 +1,266 @@
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "regionMetrics.h"
+using namespace std;
+
+static atomic<uint64_t> nextMetricsId{1};
+
+//////////////////
+// Region metrics class implementation
+RegionMetrics::RegionMetrics()
+{
+    id = nextMetricsId.fetch_add(1);
+    alive = make_shared<atomic<bool>>(true);
+    for (auto &thread : threads)
+    {
+        thread.store(nullptr, memory_order_relaxed);
+    }
+    threadCount = 0;
+    overflow.shared = true;
+}
+
+RegionMetrics::~RegionMetrics()
+{
+    alive->store(false, memory_order_relaxed);
+    for (int i = 0; i < threadCount.load(); ++i)
+    {
+        delete threads[i].load();
+    }
+}
+
+// A block a thread registered with a region
+struct KnownMetrics
+{
+    uint64_t id;
+    ThreadMetrics *metrics;
+    shared_ptr<const atomic<bool>> alive;
+};
+
+// Find or register the block of the calling thread. Every thread remembers
+// the blocks it has for each live region, so this only locks once per thread
+// and region. Sweeps create and destroy thousands of regions on the same
+// threads, so the blocks of destroyed ones are dropped on the way
+ThreadMetrics &RegionMetrics::lookup()
+{
+    thread_local vector<KnownMetrics> known;
+    for (size_t i = 0; i < known.size();)
+    {
+        if (known[i].id == id)
+        {
+            return *known[i].metrics;
+        }
+        if (!known[i].alive->load(memory_order_relaxed))
+        {
+            known[i] = std::move(known.back());
+            known.pop_back();
+            continue;
+        }
+        ++i;
+    }
+
+    ThreadMetrics *metrics = &overflow;
+    {
+        std::lock_guard<std::mutex> lock(registerMutex);
+        int index = threadCount.load(memory_order_relaxed);
+        if (index < maxThreads)
+        {
+            metrics = new ThreadMetrics();
+            threads[index].store(metrics, memory_order_release);
+            threadCount.store(index + 1, memory_order_release);
+        }
+    }
+    known.push_back({id, metrics, alive});
+    return *metrics;
+}
+
+// Add up the blocks of every thread. The writers keep going, so the figures
+// of a snapshot may be a few records apart from each other
+MetricsSnapshot RegionMetrics::snapshot() const
+{
+    MetricsSnapshot result;
+    int count = threadCount.load(memory_order_acquire);
+    result.threads = count;
+    for (int i = 0; i <= count; ++i)
+    {
+        const ThreadMetrics &metrics = i < count ? *threads[i].load(memory_order_acquire) : overflow;
+        for (int counter = 0; counter < metricCounterCount; ++counter)
+        {
+            result.counters[counter] += metrics.counters[counter].load(memory_order_relaxed);
+        }
+        for (int from = 0; from < metricStatusCount; ++from)
+        {
+            for (int to = 0; to < metricStatusCount; ++to)
+            {
+                result.transitions[from][to] += metrics.transitions[from][to].load(memory_order_relaxed);
+            }
+        }
+        for (int histogram = 0; histogram < metricHistogramCount; ++histogram)
+        {
+            HistogramSnapshot &merged = result.histograms[histogram];
+            for (int bucket = 0; bucket < HistogramBuckets::count; ++bucket)
+            {
+                uint64_t samples = metrics.buckets[histogram][bucket].load(memory_order_relaxed);
+                merged.buckets[bucket] += samples;
+                merged.count += samples;
+            }
+            merged.sum += metrics.sums[histogram].load(memory_order_relaxed);
+            merged.max = std::max(merged.max, metrics.maxima[histogram].load(memory_order_relaxed));
+        }
+    }
+    return result;
+}
+
+static void writeHistogramJson(ostream &out, const HistogramSnapshot &histogram)
+{
+    out << "{\"count\":" << histogram.count
+        << ",\"mean\":" << histogram.mean()
+        << ",\"p50\":" << histogram.percentile(0.5)
+        << ",\"p90\":" << histogram.percentile(0.9)
+        << ",\"p99\":" << histogram.percentile(0.99)
+        << ",\"p999\":" << histogram.percentile(0.999)
+        << ",\"max\":" << histogram.max << "}";
+}
+
+void writeMetricsJson(ostream &out, const string &regionName, double clockSeconds, const MetricsSnapshot &snapshot, const FleetViewImage &fleet)
+{
+    out << "{\"region\":\"" << regionName << "\",\"clock_seconds\":" << clockSeconds
+        << ",\"threads\":" << snapshot.threads << ",\"counters\":{";
+    for (int counter = 0; counter < metricCounterCount; ++counter)
+    {
+        out << (counter > 0 ? "," : "") << "\"" << metricCounterNames[counter] << "\":" << snapshot.counters[counter];
+    }
+    // Only the transitions that happened, keyed "old->new"
+    out << "},\"transitions\":{";
+    bool first = true;
+    for (int from = 0; from < metricStatusCount; ++from)
+    {
+        for (int to = 0; to < metricStatusCount; ++to)
+        {
+            if (snapshot.transitions[from][to] > 0)
+            {
+                out << (first ? "" : ",") << "\"" << from - 1 << "->" << to - 1 << "\":" << snapshot.transitions[from][to];
+                first = false;
+            }
+        }
+    }
+    out << "},\"histograms\":{\"queue_wait_ns\":";
+    writeHistogramJson(out, snapshot.queueWaitNs);
+    for (int histogram = 0; histogram < metricHistogramCount; ++histogram)
+    {
+        out << ",\"" << metricHistogramNames[histogram] << "\":";
+        writeHistogramJson(out, snapshot.histograms[histogram]);
+    }
+    out << "},\"fleet\":{\"servers_per_status\":[";
+    for (int status = 0; status < reportStatusCount; ++status)
+    {
+        out << (status > 0 ? "," : "") << fleet.serversPerStatus[status];
+    }
+    out << "],\"booting\":" << fleet.bootingServers << ",\"retiring\":" << fleet.retiringServers << ",\"instance_types\":{";
+    for (int type = 0; type < Constants::instanceTypeCount; ++type)
+    {
+        out << (type > 0 ? "," : "") << "\"" << Constants::instanceTypeNames[type] << "\":{\"servers\":" << fleet.serversPerType[type]
+            << ",\"processes\":" << fleet.processesPerType[type] << ",\"vcpu_milli\":" << fleet.usedVcpuMilliPerType[type]
+            << ",\"memory_mb\":" << fleet.usedMemoryMbPerType[type] << "}";
+    }
+    out << "}}}\n";
+}
+
+//////////////////
+// Metrics exporter class implementation
+static const string socketScheme = "unix:";
+
+MetricsExporter::MetricsExporter(const string &target)
+{
+    socketFd = -1;
+    stopping = false;
+    if (target.rfind(socketScheme, 0) == 0)
+    {
+        socketPath = target.substr(socketScheme.size());
+        if (socketPath.empty() || socketPath.size() >= sizeof(sockaddr_un::sun_path))
+        {
+            throw std::invalid_argument("Invalid metrics socket path: " + socketPath);
+        }
+        socketFd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (socketFd < 0)
+        {
+            throw std::runtime_error("Cannot open a metrics socket: " + string(strerror(errno)));
+        }
+    }
+    else
+    {
+        file.open(target, ios::trunc);
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open metrics file " + target);
+        }
+    }
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+    if (socketFd >= 0)
+    {
+        close(socketFd);
+    }
+}
+
+void MetricsExporter::write(const string &line)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (socketFd < 0)
+    {
+        file << line;
+        file.flush();
+        return;
+    }
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    // Nobody listening or a full receive buffer loses the line
+    sendto(socketFd, line.data(), line.size(), 0, (const sockaddr *)&address, sizeof(address));
+}
+
+void MetricsExporter::start(double intervalSeconds, function<string()> produce)
+{
+    auto interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(intervalSeconds));
+    worker = thread([this, interval, produce]()
+                    {
+                        std::unique_lock<std::mutex> lock(stopMutex);
+                        while (!stopCondition.wait_for(lock, interval, [this]()
+                                                       { return stopping; }))
+                        {
+                            lock.unlock();
+                            write(produce());
+                            lock.lock();
+                        } });
+}
+
+void MetricsExporter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopCondition.notify_all();
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+string MetricsExporter::targetFor(const string &target, const string &regionName)
+{
+    if (target.rfind(socketScheme, 0) == 0)
+    {
+        return target;
+    }
+    return target + "_" + regionName + ".metrics";
+}
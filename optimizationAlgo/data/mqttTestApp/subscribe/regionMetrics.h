@@ -0,0 +1,205 @@
+#ifndef REGION_METRICS
+#define REGION_METRICS
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include "../common/latencyHistogram.h"
+#include "fleetView.h"
+using namespace std;
+
+// Running totals of a region, they only ever grow
+enum class MetricCounter : int
+{
+    MessagesReceived,
+    RequestsReceived,
+    // Requests in a payload that failed to decode and were skipped
+    RequestsMalformed,
+    RequestsPlaced,
+    ServersOpened,
+    ServersClosed,
+    RequestsSpilledOut,
+    RequestsSpilledIn,
+    ProcessesMigrated,
+    // Requests that waited in the admission queue and then started, the ones
+    // turned away and the ones whose deadline passed while they waited
+    RequestsQueued,
+    RequestsRejected,
+    RequestsExpired,
+    Count
+};
+
+enum class MetricHistogram : int
+{
+    // Time the receiver takes to decode a message and queue its requests, in nanoseconds
+    IngestNs,
+    // Placement time of a request, averaged over the batch a worker places it in, in nanoseconds
+    PlacementNs,
+    // How long closed servers ran, in milliseconds of the region's clock
+    ServerLifetimeMs,
+    // Time queued requests waited for room, in milliseconds of the region's clock
+    AdmissionWaitMs,
+    Count
+};
+
+inline constexpr int metricCounterCount = (int)MetricCounter::Count;
+inline constexpr int metricHistogramCount = (int)MetricHistogram::Count;
+// Server statuses -1 (closed) to 3, counted from 0
+inline constexpr int metricStatusCount = 5;
+
+inline constexpr const char *metricCounterNames[metricCounterCount] = {
+    "messages_received", "requests_received", "requests_malformed", "requests_placed", "servers_opened",
+    "servers_closed", "requests_spilled_out", "requests_spilled_in", "processes_migrated",
+    "requests_queued", "requests_rejected", "requests_expired"};
+inline constexpr const char *metricHistogramNames[metricHistogramCount] = {
+    "ingest_ns", "placement_ns", "server_lifetime_ms", "admission_wait_ms"};
+
+// Counters and histograms of a single thread. Only that thread writes them,
+// so a record is a relaxed load and store instead of a locked
+// read-modify-write, and other threads read them without stopping it
+struct alignas(64) ThreadMetrics
+{
+    void add(MetricCounter counter, uint64_t amount = 1)
+    {
+        bump(counters[(int)counter], amount);
+    }
+
+    void record(MetricHistogram histogram, uint64_t value, uint64_t weight = 1)
+    {
+        int index = (int)histogram;
+        bump(buckets[index][HistogramBuckets::bucketOf(value)], weight);
+        bump(sums[index], value * weight);
+        uint64_t largest = maxima[index].load(memory_order_relaxed);
+        while (value > largest)
+        {
+            if (!shared)
+            {
+                maxima[index].store(value, memory_order_relaxed);
+                break;
+            }
+            if (maxima[index].compare_exchange_weak(largest, value, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+    }
+
+    void transition(int oldStatus, int newStatus)
+    {
+        bump(transitions[oldStatus + 1][newStatus + 1], 1);
+    }
+
+    void bump(atomic<uint64_t> &value, uint64_t amount)
+    {
+        if (shared)
+        {
+            value.fetch_add(amount, memory_order_relaxed);
+        }
+        else
+        {
+            value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+        }
+    }
+
+    // Set on the block of the threads beyond RegionMetrics::maxThreads,
+    // which share it and need atomic additions
+    bool shared = false;
+    atomic<uint64_t> counters[metricCounterCount] = {};
+    atomic<uint64_t> transitions[metricStatusCount][metricStatusCount] = {};
+    atomic<uint64_t> buckets[metricHistogramCount][HistogramBuckets::count] = {};
+    atomic<uint64_t> sums[metricHistogramCount] = {};
+    atomic<uint64_t> maxima[metricHistogramCount] = {};
+};
+
+// Sum of the metrics of every thread of a region at one moment
+struct MetricsSnapshot
+{
+    uint64_t counters[metricCounterCount] = {};
+    // transitions[old + 1][new + 1] counts the status changes from old to new
+    uint64_t transitions[metricStatusCount][metricStatusCount] = {};
+    HistogramSnapshot histograms[metricHistogramCount];
+    // Time requests wait in the placement queue, kept by the placement pool
+    HistogramSnapshot queueWaitNs;
+    int threads = 0;
+};
+
+// Per-thread metrics of one region. Each thread gets its own block the first
+// time it records, snapshots add the blocks up while they are being written
+class RegionMetrics
+{
+public:
+    RegionMetrics();
+    ~RegionMetrics();
+    RegionMetrics(const RegionMetrics &) = delete;
+    RegionMetrics &operator=(const RegionMetrics &) = delete;
+
+    // Block of the calling thread
+    ThreadMetrics &local()
+    {
+        thread_local uint64_t cachedOwner = 0;
+        thread_local ThreadMetrics *cachedMetrics = nullptr;
+        if (cachedOwner != id)
+        {
+            cachedMetrics = &lookup();
+            cachedOwner = id;
+        }
+        return *cachedMetrics;
+    }
+
+    MetricsSnapshot snapshot() const;
+
+    static constexpr int maxThreads = 256;
+
+private:
+    ThreadMetrics &lookup();
+
+    // Never reused, so a thread's cached block of a destroyed region is never
+    // mistaken for the block of a new one at the same address
+    uint64_t id;
+    // Cleared on destruction, threads drop the blocks of destroyed regions
+    // from their list when they next look one up
+    shared_ptr<atomic<bool>> alive;
+    atomic<ThreadMetrics *> threads[maxThreads];
+    atomic<int> threadCount;
+    std::mutex registerMutex;
+    ThreadMetrics overflow;
+};
+
+// One JSON object per snapshot, on a single line, with the fleet view read at the same time
+void writeMetricsJson(ostream &out, const string &regionName, double clockSeconds, const MetricsSnapshot &snapshot, const FleetViewImage &fleet);
+
+// Sends metrics lines to a file, or to a local datagram socket when the
+// target is "unix:<path>". A socket gets one datagram per line and loses the
+// lines nobody listens for, so exporting never blocks the region
+class MetricsExporter
+{
+public:
+    MetricsExporter(const string &target);
+    ~MetricsExporter();
+    void write(const string &line);
+    // Writes the line produce returns every interval from a thread of its own until stop
+    void start(double intervalSeconds, function<string()> produce);
+    void stop();
+
+    // The target of one region: <prefix>_<region>.metrics, or the socket all regions share
+    static string targetFor(const string &target, const string &regionName);
+
+private:
+    std::mutex writeMutex;
+    std::ofstream file;
+    string socketPath;
+    int socketFd;
+
+    thread worker;
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    bool stopping;
+};
+
+#endif
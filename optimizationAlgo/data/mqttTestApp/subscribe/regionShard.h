@@ -0,0 +1,73 @@
+#ifndef REGION_SHARD
+#define REGION_SHARD
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "appConst.h"
+#include "fleetView.h"
+#include "objectPool.h"
+#include "placementEngine.h"
+#include "serverBuckets.h"
+#include "shardTotals.h"
+using namespace std;
+
+class Server;
+class Process;
+
+// One partition of a region's fleet. Every server belongs to one shard for
+// its whole life and its state is only touched with that shard's mutex held,
+// so placements and completions on different shards run in parallel.
+// Work that spans the fleet (forecasting, consolidation, right-sizing and the
+// end of day report) locks every shard in index order.
+// The shard's servers and the processes running on them live in its pools
+struct alignas(64) RegionShard
+{
+    RegionShard(int indexInput, PlacementPolicy placementPolicy)
+        : placementEngine(placementPolicy)
+    {
+        index = indexInput;
+    }
+
+    // Servers of the shard in any status
+    size_t serverCount() const
+    {
+        size_t servers = 0;
+        for (int status = 0; status < ServerBuckets::statusCount; ++status)
+        {
+            servers += serverBuckets.size(status);
+        }
+        return servers;
+    }
+
+    int index;
+    std::mutex mutex;
+    // Declared first so the servers outlive the structures that link them
+    ObjectPool<Server> serverPool;
+    ObjectPool<Process> processPool;
+    // Servers taken out of the fleet whose slot is released once no caller
+    // up the stack can still be using them
+    vector<Server *> closedServers;
+    // Servers grouped by status:
+    // 0: # of processes between min and max thresholds
+    // 1: # of processes smaller than the min threshold
+    // 2: # of processes larger than the max threshold
+    // 3: maximum possible # of processes
+    ServerBuckets serverBuckets;
+    // Free capacity view of the same servers for the fit based policies
+    PlacementEngine placementEngine;
+    // Servers that are still booting, in launch order
+    vector<Server *> bootingServers;
+    // Booting replacements paired with the server they replace, which may
+    // close by itself in the meantime
+    vector<pair<PoolHandle<Server>, PoolHandle<Server>>> pendingRightSizes;
+    ShardTotals totals;
+    // Servers changed since the last fleet snapshot took the shard's changes,
+    // each listed once with its id, which a closed server's handle no longer
+    // leads to. Only kept while snapshots are on
+    vector<pair<uint32_t, PoolHandle<Server>>> snapshotChanges;
+    // Lock-free copy of the shard's servers for reports and monitoring
+    ShardView view;
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include <cstring>  // memcmp.
+#include <fstream>  // std::ifstream, std::ofstream.
+#include <iostream> // std::cout.
+#include <list>     // bucket order.
+#include <unordered_map>
+#include <vector>
+#include "appConst.h"
+#include "eventLog.h"
+#include "reportFormat.h"
+using namespace std;
+
+// A server as reconstructed from the event log
+struct RenderedServer
+{
+    Constants::InstanceType instanceType;
+    int processCount;
+    int status;
+    list<uint32_t>::iterator position;
+};
+
+// Replays a binary fleet event log and writes the "Infrastructure update"
+// snapshots that the region used to print after every process addition and
+// every server closure. Usage: renderEventLog <region>_realTime_events [output]
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " <events file> [output file]" << endl;
+        return 1;
+    }
+
+    ifstream input(argv[1], ios::binary);
+    EventLogHeader header;
+    if (!input.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        memcmp(header.magic, eventLogMagic, sizeof(header.magic)) != 0 ||
+        header.version != eventLogVersion || header.recordSize != sizeof(FleetEvent))
+    {
+        cerr << argv[1] << " is not a fleet event log of this version" << endl;
+        return 1;
+    }
+
+    ofstream outputFile;
+    if (argc > 2)
+    {
+        outputFile.open(argv[2], ios::trunc);
+    }
+    ostream &output = argc > 2 ? outputFile : cout;
+
+    // Bucket order is the order of moves, the latest moved server first
+    list<uint32_t> buckets[reportStatusCount];
+    unordered_map<uint32_t, RenderedServer> servers;
+
+    auto writeSnapshot = [&]()
+    {
+        vector<ServerLoad> serversPerStatus[reportStatusCount];
+        for (int status = 0; status < reportStatusCount; ++status)
+        {
+            for (uint32_t id : buckets[status])
+            {
+                const RenderedServer &server = servers.at(id);
+                serversPerStatus[status].push_back({server.instanceType, server.processCount});
+            }
+        }
+        writeInfrastructureUpdate(output, serversPerStatus);
+    };
+
+    FleetEvent event;
+    unsigned long long eventIndex = 0;
+    while (input.read(reinterpret_cast<char *>(&event), sizeof(event)))
+    {
+        ++eventIndex;
+        // A damaged or foreign file must not index past the buckets
+        bool opensOrMoves = event.kind == FleetEventKind::ServerOpened || event.kind == FleetEventKind::StatusChanged;
+        if (event.kind > FleetEventKind::ProcessMigrated ||
+            (opensOrMoves && (event.newStatus < 0 || event.newStatus >= reportStatusCount)) ||
+            (event.kind == FleetEventKind::ServerOpened && (event.instanceType >= Constants::instanceTypeCount || servers.count(event.serverId) > 0)))
+        {
+            cerr << argv[1] << ": event " << eventIndex << " is not a valid fleet event" << endl;
+            return 1;
+        }
+
+        switch (event.kind)
+        {
+        case FleetEventKind::ServerOpened:
+        {
+            RenderedServer server{static_cast<Constants::InstanceType>(event.instanceType), event.processCount, -1, {}};
+            buckets[event.newStatus].push_front(event.serverId);
+            server.status = event.newStatus;
+            server.position = buckets[event.newStatus].begin();
+            servers[event.serverId] = server;
+            break;
+        }
+        case FleetEventKind::StatusChanged:
+        {
+            auto it = servers.find(event.serverId);
+            if (it != servers.end())
+            {
+                RenderedServer &server = it->second;
+                buckets[server.status].erase(server.position);
+                buckets[event.newStatus].push_front(event.serverId);
+                server.status = event.newStatus;
+                server.position = buckets[event.newStatus].begin();
+                server.processCount = event.processCount;
+            }
+            break;
+        }
+        case FleetEventKind::ProcessAdded:
+        case FleetEventKind::ProcessRemoved:
+        case FleetEventKind::ProcessMigrated:
+        {
+            auto it = servers.find(event.serverId);
+            if (it != servers.end())
+            {
+                it->second.processCount = event.processCount;
+            }
+            if (event.kind == FleetEventKind::ProcessAdded)
+            {
+                writeSnapshot();
+            }
+            break;
+        }
+        case FleetEventKind::ServerClosed:
+        {
+            auto it = servers.find(event.serverId);
+            if (it != servers.end())
+            {
+                buckets[it->second.status].erase(it->second.position);
+                servers.erase(it);
+            }
+            writeSnapshot();
+            break;
+        }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef REPORT_FORMAT
+#define REPORT_FORMAT
+#include <ostream>
+#include <vector>
+#include "appConst.h"
+using namespace std;
+
+// Instance type and process count of one server as shown in the reports
+struct ServerLoad
+{
+    Constants::InstanceType instanceType;
+    int processCount;
+};
+
+inline constexpr int reportStatusCount = 4;
+
+// Write one "Infrastructure update" block, the servers of each status listed
+// in the order given. Shared by the live report and the event log renderer so
+// both produce the same text
+inline void writeInfrastructureUpdate(std::ostream &reportStream, const vector<ServerLoad> (&serversPerStatus)[reportStatusCount])
+{
+    reportStream << "Infrastructure update:\n";
+    reportStream << "---------------------------\n";
+    for (int status = 0; status < reportStatusCount; ++status)
+    {
+        reportStream << "Total Number of Server Type " << status << ": " << serversPerStatus[status].size() << "\n";
+    }
+    reportStream << "---------------------------\n";
+
+    // Print individual server details for each status type
+    for (int status = 0; status < reportStatusCount; ++status)
+    {
+        if (!serversPerStatus[status].empty())
+        {
+            reportStream << "Individual Server Type " << status << " Process Numbers:\n";
+            for (const auto &server : serversPerStatus[status])
+            {
+                reportStream << Constants::instanceTypeName(server.instanceType) << ":" << server.processCount << "/";
+            }
+            reportStream << "\n";
+        }
+    }
+
+    reportStream << "---------------------------\n\n";
+}
+
+#endif
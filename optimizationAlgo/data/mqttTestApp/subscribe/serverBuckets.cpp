@@ -0,0 +1,89 @@
+#include "serverBuckets.h"
+#include "messageReceiver.h"
+using namespace std;
+
+//////////////////
+// Server buckets class implementation
+ServerBuckets::~ServerBuckets()
+{
+    clear();
+}
+
+void ServerBuckets::moveToFront(int status, Server *server)
+{
+    BucketLink &link = server->bucketLink;
+    if (link.bucket != -1)
+    {
+        unlink(link);
+    }
+
+    link.previous = nullptr;
+    link.next = heads[status];
+    if (heads[status] != nullptr)
+    {
+        heads[status]->previous = &link;
+    }
+    heads[status] = &link;
+    link.bucket = status;
+    link.owner = server;
+    link.moveOrder = ++moves;
+    ++sizes[status];
+}
+
+void ServerBuckets::remove(Server *server)
+{
+    if (server->bucketLink.bucket != -1)
+    {
+        unlink(server->bucketLink);
+    }
+}
+
+Server *ServerBuckets::front(int status) const
+{
+    return heads[status] != nullptr ? heads[status]->owner : nullptr;
+}
+
+size_t ServerBuckets::size(int status) const
+{
+    return sizes[status];
+}
+
+bool ServerBuckets::empty(int status) const
+{
+    return heads[status] == nullptr;
+}
+
+// Unlink every server
+void ServerBuckets::clear()
+{
+    for (int status = 0; status < statusCount; ++status)
+    {
+        while (heads[status] != nullptr)
+        {
+            unlink(*heads[status]);
+        }
+    }
+}
+
+// Take the link out of its list
+void ServerBuckets::unlink(BucketLink &link)
+{
+    if (link.previous != nullptr)
+    {
+        link.previous->next = link.next;
+    }
+    else
+    {
+        heads[link.bucket] = link.next;
+    }
+    if (link.next != nullptr)
+    {
+        link.next->previous = link.previous;
+    }
+    --sizes[link.bucket];
+
+    link.previous = nullptr;
+    link.next = nullptr;
+    link.bucket = -1;
+    link.owner = nullptr;
+}
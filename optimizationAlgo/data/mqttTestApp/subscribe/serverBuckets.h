@@ -0,0 +1,79 @@
+#ifndef SERVER_BUCKETS
+#define SERVER_BUCKETS
+#include <cstddef>
+#include <cstdint>
+using namespace std;
+
+class Server;
+
+// Position of a server inside its status bucket. Every server carries one, so
+// unlinking it does not need to search the bucket. The region's server pool
+// owns the server, a server is unlinked before it is released
+struct BucketLink
+{
+    BucketLink *previous = nullptr;
+    BucketLink *next = nullptr;
+    int bucket = -1;
+    Server *owner = nullptr;
+    // Rises with every move, so a bucket is ordered by falling moveOrder
+    uint64_t moveOrder = 0;
+};
+
+// Servers of a region grouped by status in intrusive doubly-linked lists.
+// Moving a server between statuses, removing it and taking the first server
+// of a status are all O(1). Newly moved servers go to the front, so the
+// iteration order matches the old insert-at-begin vectors
+class ServerBuckets
+{
+public:
+    static constexpr int statusCount = 4;
+
+    ServerBuckets() = default;
+    ServerBuckets(const ServerBuckets &) = delete;
+    ServerBuckets &operator=(const ServerBuckets &) = delete;
+    ~ServerBuckets();
+
+    // Unlinks the server from its current bucket (if any) and links it at the front of status
+    void moveToFront(int status, Server *server);
+    // Unlinks the server from whatever bucket it is in, no-op if it is in none
+    void remove(Server *server);
+    Server *front(int status) const;
+    size_t size(int status) const;
+    bool empty(int status) const;
+    void clear();
+
+    // Calls visit for every server of the status, front to back. The visitor
+    // must not move or remove servers
+    template <typename Visitor>
+    void forEach(int status, Visitor visit) const
+    {
+        for (BucketLink *link = heads[status]; link != nullptr; link = link->next)
+        {
+            visit(link->owner);
+        }
+    }
+
+    // Returns the first server of the status, front to back, that matches the
+    // predicate, nullptr if none does
+    template <typename Predicate>
+    Server *findFirst(int status, Predicate matches) const
+    {
+        for (BucketLink *link = heads[status]; link != nullptr; link = link->next)
+        {
+            if (matches(link->owner))
+            {
+                return link->owner;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    void unlink(BucketLink &link);
+
+    BucketLink *heads[statusCount] = {};
+    size_t sizes[statusCount] = {};
+    uint64_t moves = 0;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef SHARD_TOTALS
+#define SHARD_TOTALS
+#include <algorithm>
+#include "appConst.h"
+#include "../common/requestMessage.h"
+using namespace std;
+
+// Figures of a shard that the end of day report adds up over the shards
+struct ShardTotals
+{
+    float serverCost = 0;
+    float costPerInstanceType[Constants::instanceTypeCount] = {};
+    float processes = 0;
+    int scalings = 0;
+    // Seconds processes waited for their server to boot
+    double processHoldup = 0;
+    // Servers launched ahead of demand by the forecast
+    int prewarmedServers = 0;
+    // Processes moved by consolidation and right-sizing and the pause they
+    // added to their run time
+    int migrations = 0;
+    double migrationPause = 0;
+    int rightSizes = 0;
+    // Requests handed to and taken from other regions by the coordinator
+    int spilledOut = 0;
+    int spilledIn = 0;
+    double spillLatencyMs = 0;
+    // Requests that waited in the admission queue for the fleet limits and
+    // how long, and the ones turned away per priority class because the
+    // queue was full or their deadline passed
+    int queuedRequests = 0;
+    double queueWaitSeconds = 0;
+    double longestQueueWaitSeconds = 0;
+    int rejectedRequests[requestPriorityCount] = {};
+    int expiredRequests[requestPriorityCount] = {};
+
+    void add(const ShardTotals &other)
+    {
+        serverCost += other.serverCost;
+        for (int i = 0; i < Constants::instanceTypeCount; ++i)
+        {
+            costPerInstanceType[i] += other.costPerInstanceType[i];
+        }
+        processes += other.processes;
+        scalings += other.scalings;
+        processHoldup += other.processHoldup;
+        prewarmedServers += other.prewarmedServers;
+        migrations += other.migrations;
+        migrationPause += other.migrationPause;
+        rightSizes += other.rightSizes;
+        spilledOut += other.spilledOut;
+        spilledIn += other.spilledIn;
+        spillLatencyMs += other.spillLatencyMs;
+        queuedRequests += other.queuedRequests;
+        queueWaitSeconds += other.queueWaitSeconds;
+        longestQueueWaitSeconds = std::max(longestQueueWaitSeconds, other.longestQueueWaitSeconds);
+        for (int i = 0; i < requestPriorityCount; ++i)
+        {
+            rejectedRequests[i] += other.rejectedRequests[i];
+            expiredRequests[i] += other.expiredRequests[i];
+        }
+    }
+};
+
+#endif
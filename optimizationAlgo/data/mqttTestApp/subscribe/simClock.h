@@ -0,0 +1,55 @@
+#ifndef SIM_CLOCK
+#define SIM_CLOCK
+#include <chrono>
+using namespace std;
+
+// Source of "now" for the regional algorithm. The real-time path reads the
+// steady clock while the discrete-event simulation advances a virtual clock
+// from event to event, so both run the exact same placement code
+class SimClock
+{
+public:
+    virtual ~SimClock() = default;
+    virtual std::chrono::steady_clock::time_point now() = 0;
+    // A virtual clock does not move by itself, nothing may sleep on it
+    virtual bool isVirtual() = 0;
+};
+
+class RealClock : public SimClock
+{
+public:
+    std::chrono::steady_clock::time_point now() override
+    {
+        return chrono::steady_clock::now();
+    }
+    bool isVirtual() override
+    {
+        return false;
+    }
+};
+
+class VirtualClock : public SimClock
+{
+public:
+    std::chrono::steady_clock::time_point now() override
+    {
+        return current;
+    }
+    bool isVirtual() override
+    {
+        return true;
+    }
+    // Move the simulated time forward, time never goes backwards
+    void advanceTo(std::chrono::steady_clock::time_point target)
+    {
+        if (target > current)
+        {
+            current = target;
+        }
+    }
+
+private:
+    std::chrono::steady_clock::time_point current{};
+};
+
+#endif